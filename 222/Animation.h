@@ -65,45 +65,57 @@ namespace ui
 	{
 	private:
 		ecs::DoubleComs<AnimationCom>& animations;
+		ecs::Layers* unitsLayer;
+		ecs::Layers* uiLayer;
 
 	public:
-		AnimationSystem(ecs::DoubleComs<AnimationCom>* animations) : animations(*animations) {}
+		AnimationSystem(ecs::DoubleComs<AnimationCom>* animations, ecs::Layers* unitsLayer, ecs::Layers* uiLayer) : animations(*animations), unitsLayer(unitsLayer), uiLayer(uiLayer) {}
+
+		const char* name() const override
+		{
+			return "ui::AnimationSystem";
+		}
+
+		ecs::SystemAccess access() const override//Դͼָ룬ͼ
+		{
+			return ecs::SystemAccess::Shared().write(&animations).write(unitsLayer).write(uiLayer);
+		}
 
 		AnimationSystem& stop(ecs::entity id)
 		{
-			if (auto active = animations.active()->get(id) != nullptr)
+			if (auto active = animations.active()->get(id))
 			{
-				animations.active()->get(id)->stop = true;
+				active->stop = true;
 			}
-			if (auto active = animations.inactive()->get(id) != nullptr)
+			if (auto inactive = animations.inactive()->get(id))
 			{
-				animations.inactive()->get(id)->stop = true;
+				inactive->stop = true;
 			}
 			return *this;
 		}
 
 		AnimationSystem& play(ecs::entity id)
 		{
-			if (auto active = animations.active()->get(id) != nullptr)
+			if (auto active = animations.active()->get(id))
 			{
-				animations.active()->get(id)->stop = false;
+				active->stop = false;
 			}
-			if (auto active = animations.inactive()->get(id) != nullptr)
+			if (auto inactive = animations.inactive()->get(id))
 			{
-				animations.inactive()->get(id)->stop = false;
+				inactive->stop = false;
 			}
 			return *this;
 		}
 
 		AnimationSystem& loop(ecs::entity id, bool state)
 		{
-			if (auto active = animations.active()->get(id) != nullptr)
+			if (auto active = animations.active()->get(id))
 			{
-				animations.active()->get(id)->loop = state;
+				active->loop = state;
 			}
-			if (auto active = animations.inactive()->get(id) != nullptr)
+			if (auto inactive = animations.inactive()->get(id))
 			{
-				animations.inactive()->get(id)->loop = state;
+				inactive->loop = state;
 			}
 			return *this;
 		}
@@ -147,7 +159,7 @@ namespace ui
 	void ApplyAnimation(ecs::World2D& world)
 	{
 		world.addPool<AnimationCom>();
-		world.addSystem(AnimationSystem(world.getDoubleBuffer<AnimationCom>()));
+		world.addSystem(AnimationSystem(world.getDoubleBuffer<AnimationCom>(), world.getUnitsLayer(), world.getUiLayer()));
 	}
 
 
@@ -207,9 +219,21 @@ namespace ui
 	{
 	private:
 		ecs::DoubleComs<KeyFramesAnimationCom>& coms;
+		ecs::Layers* unitsLayer;
+		ecs::Layers* uiLayer;
 
 	public:
-		KeyFramesAnimationSystem(ecs::DoubleComs<KeyFramesAnimationCom>* coms) : coms(*coms) {}
+		KeyFramesAnimationSystem(ecs::DoubleComs<KeyFramesAnimationCom>* coms, ecs::Layers* unitsLayer, ecs::Layers* uiLayer) : coms(*coms), unitsLayer(unitsLayer), uiLayer(uiLayer) {}
+
+		const char* name() const override
+		{
+			return "ui::KeyFramesAnimationSystem";
+		}
+
+		ecs::SystemAccess access() const override
+		{
+			return ecs::SystemAccess::Shared().write(&coms).write(unitsLayer).write(uiLayer);
+		}
 
 		void update() override
 		{
@@ -330,6 +354,6 @@ namespace ui
 	void ApplyKeyFramesAnimation(ecs::World2D& world)
 	{
 		world.addPool<KeyFramesAnimationCom>();
-		world.addSystem(KeyFramesAnimationSystem(world.getDoubleBuffer<KeyFramesAnimationCom>()));
+		world.addSystem(KeyFramesAnimationSystem(world.getDoubleBuffer<KeyFramesAnimationCom>(), world.getUnitsLayer(), world.getUiLayer()));
 	}
 }
\ No newline at end of file
@@ -6,543 +6,2476 @@
 #include <mutex>
 #include <thread>
 #include <typeindex>
+#include <atomic>
 #include <execution>
 #include <algorithm>
 #include <array>
+#include <optional>
+#include <tuple>
+#include <utility>
+#include <bitset>
+#include <functional>
 
+//޴ڹ׼ԣECS_HEADLESSͷļֻõraylibVector2
+#ifdef ECS_HEADLESS
+struct Vector2
+{
+	float x;
+	float y;
+};
+#else
 #include <raylib.h>
 #include <raymath.h>
+#endif
+
+//ΧཻSIMDʵ֣ѡѡ񣬶ECS_NO_SIMDֻñʵ
+#if !defined(ECS_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define ECS_SIMD_SSE
+#include <immintrin.h>
+#endif
+#if defined(ECS_SIMD_SSE) && defined(__AVX2__)
+#define ECS_SIMD_AVX2
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 #include "attachedLib.h"
+#include "Snapshot.h"
 
 namespace ecs
 {
 	template<typename T>
 	class DoubleBuffered;
 
-	template<typename T>
+	template<typename T, typename = void>
 	class ComponentPool;
 
+	template<typename ...Ts>
+	class View;
+
 	template<typename T>
 	using DoubleComs = ecs::DoubleBuffered<ecs::ComponentPool<T>*>;
 
-	using entity = uint64_t;
+	using entity = uint64_t;//32λΪ32λΪ汾
 
-	class IdManager
-	{
-	private:
-		uint64_t countId = 0;
-		std::vector<entity> inactive;
-	public:
-		uint64_t getId()
-		{
-			if (inactive.empty())
-			{
-				return countId++;
-			}
-			else
-			{
-				uint64_t tmp = inactive.back();
-				inactive.pop_back();
-				return tmp;
-			}
-		}
-		void recycleId(uint64_t id)
-		{
-			inactive.push_back(id);
-		}
-		size_t size() const
-		{
-			return countId - inactive.size();
-		}
-	};
+	constexpr entity NULL_ENTITY = UINT64_MAX;
 
-	class ComponentPoolBase
+	inline constexpr uint32_t EntityIndex(const entity id)
 	{
-	public:
-		ComponentPoolBase() = default;
-		virtual ComponentPoolBase& remove(const entity id) = 0;
-		virtual ~ComponentPoolBase() = default;
-	};
+		return uint32_t(id);
+	}
+	inline constexpr uint32_t EntityVersion(const entity id)
+	{
+		return uint32_t(id >> 32);
+	}
+	inline constexpr entity MakeEntity(const uint32_t index, const uint32_t version)
+	{
+		return (entity(version) << 32) | index;
+	}
 
-	//using T = int;
+	//͵ĳܱţ״ʹʱ0䣬Worldֱ
+	inline size_t NextComponentTypeId()
+	{
+		static std::atomic<size_t> counter{ 0 };
+		return counter.fetch_add(1, std::memory_order_relaxed);
+	}
 	template<typename T>
-	class ComponentPool : public ComponentPoolBase
+	inline size_t ComponentTypeId()
+	{
+		static const size_t id = NextComponentTypeId();
+		return id;
+	}
+
+	constexpr size_t MAX_COMPONENT_TYPES = 64;
+	using Signature = std::bitset<MAX_COMPONENT_TYPES>;//ʵӵеͣComponentTypeIdλ
+
+	//ʵŵǩֻԵǰ汾ʵЧڼʱд룬ɶ߳ͬʱд
+	class SignatureTable
 	{
 	private:
-		std::vector<T> dataVector;
-		std::vector<entity> indexToEntity;
-		std::vector<size_t> entityToIndex;
+		struct Entry
+		{
+			entity id = NULL_ENTITY;
+			Signature components;
+		};
+		std::vector<Entry> entries;
 		mutable std::mutex mtx;
 
-	public:
-		ComponentPool() = default;
-
-		ComponentPool& add(const entity id, const T& dat)
+		Entry& entryOf(const entity id)//ͬһϵ°汾ʵӿǩʼ
 		{
-			std::lock_guard<std::mutex> lockMtx(mtx);
-			if (id < entityToIndex.size() && entityToIndex[id] != SIZE_MAX)
+			if (EntityIndex(id) >= entries.size())
 			{
-				dataVector[entityToIndex[id]] = dat;
-				return *this;
+				entries.resize(size_t(EntityIndex(id)) + 20);
 			}
-			indexToEntity.push_back(id);
-			dataVector.push_back(dat);
-			if (id >= entityToIndex.size())
+			Entry& result = entries[EntityIndex(id)];
+			if (result.id != id)
 			{
-				entityToIndex.resize(id + 20, SIZE_MAX);
+				result.id = id;
+				result.components.reset();
 			}
-			entityToIndex[id] = dataVector.size() - 1;
-			return *this;
+			return result;
 		}
-		ComponentPool& add(const entity id, T&& dat)
+	public:
+		void set(const entity* ids, const size_t count, const size_t type)
 		{
 			std::lock_guard<std::mutex> lockMtx(mtx);
-			if (id < entityToIndex.size() && entityToIndex[id] != SIZE_MAX)
+			for (size_t i = 0; i < count; ++i)
 			{
-				dataVector[entityToIndex[id]] = std::move(dat);
-				return *this;
+				entryOf(ids[i]).components.set(type);
 			}
-			indexToEntity.push_back(id);
-			dataVector.push_back(std::move(dat));
-			if (id >= entityToIndex.size())
+		}
+		Signature get(const entity id) const
+		{
+			std::lock_guard<std::mutex> lockMtx(mtx);
+			if (EntityIndex(id) < entries.size() && entries[EntityIndex(id)].id == id)
 			{
-				entityToIndex.resize(id + 20, SIZE_MAX);
+				return entries[EntityIndex(id)].components;
 			}
-			entityToIndex[id] = dataVector.size() - 1;
-			return *this;
+			return Signature();
 		}
-		ComponentPool& remove(const entity id) override
+		Signature take(const entity id)//ȡ
 		{
 			std::lock_guard<std::mutex> lockMtx(mtx);
-			if (id >= entityToIndex.size())
+			if (EntityIndex(id) < entries.size() && entries[EntityIndex(id)].id == id)
 			{
-				return *this;
+				const Signature result = entries[EntityIndex(id)].components;
+				entries[EntityIndex(id)] = Entry();
+				return result;
 			}
-			if (entityToIndex[id] == SIZE_MAX)
+			return Signature();
+		}
+		void clear()
+		{
+			std::lock_guard<std::mutex> lockMtx(mtx);
+			entries.clear();
+		}
+	};
+
+	class IdManager
+	{
+	private:
+		std::vector<uint32_t> versions;
+		std::vector<uint32_t> inactive;
+	public:
+		entity getId()
+		{
+			if (inactive.empty())
 			{
-				return *this;
+				versions.push_back(0);
+				return MakeEntity(uint32_t(versions.size() - 1), 0);
 			}
 			else
 			{
-				const size_t idx = entityToIndex[id];
-				const size_t lastIdx = dataVector.size() - 1;
-
-				if (idx != dataVector.size() - 1)
-				{
-					entityToIndex[indexToEntity[lastIdx]] = idx;
-					dataVector[idx] = std::move(dataVector[lastIdx]);
-					indexToEntity[idx] = indexToEntity[lastIdx];
-				}
-
-				dataVector.pop_back();
-				indexToEntity.pop_back();
-				entityToIndex[id] = SIZE_MAX;
-
-				return *this;
+				uint32_t index = inactive.back();
+				inactive.pop_back();
+				return MakeEntity(index, versions[index]);
 			}
 		}
-
-		//call func(id, Compornent, args...)
-		template<typename Func, typename ...Args>
-		void forEach(Func&& func, Args&& ...args)
+		std::vector<entity> getIds(const size_t count)
 		{
-			for (size_t i = 0; i < dataVector.size(); i++)
+			std::vector<entity> result(count);
+			for (auto& id : result)
 			{
-				std::forward<Func>(func)(indexToEntity[i], dataVector[i], std::forward<Args>(args)...);
+				id = getId();
 			}
+			return result;
 		}
-		template<typename Func, typename ...Args>
-		void forEach(Func&& func, Args&& ...args) const
+		void recycleId(const entity id)//պ汾ŵɾȫʧЧ
 		{
-			for (size_t i = 0; i < dataVector.size(); i++)
+			if (!isAlive(id))
 			{
-				std::forward<Func>(func)(indexToEntity[i], dataVector[i], std::forward<Args>(args)...);
+				return;
 			}
+			++versions[EntityIndex(id)];
+			inactive.push_back(EntityIndex(id));
 		}
-
-		template<typename Func, typename ...Args>
-		void forEach(ThreadPool& tp, Func&& func, Args&& ...args)
+		bool isAlive(const entity id) const
 		{
-			for (size_t i = 0; i < dataVector.size(); i++)
-			{
-				tp.enqueue(std::forward<Func>(func), indexToEntity[i], dataVector[i], std::forward<Args>(args)...);
-			}
-			tp.wait();
+			return EntityIndex(id) < versions.size() && versions[EntityIndex(id)] == EntityVersion(id);
 		}
-		template<typename Func, typename ...Args>
-		void forEach(ThreadPool& tp, Func&& func, Args&& ...args) const
+		size_t size() const
+		{
+			return versions.size() - inactive.size();
+		}
+		void save(BinaryWriter& out) const
+		{
+			out.writeArray(versions.data(), versions.size());
+			out.writeArray(inactive.data(), inactive.size());
+		}
+		bool load(BinaryReader& in)
 		{
-			for (size_t i = 0; i < dataVector.size(); i++)
+			if (in.readArray(versions) && in.readArray(inactive))
 			{
-				tp.enqueue(std::forward<Func>(func), indexToEntity[i], dataVector[i], std::forward<Args>(args)...);
+				return true;
 			}
-			tp.wait();
+			versions.clear();
+			inactive.clear();
+			return false;
 		}
+	};
 
-		T* get(const entity id)
+	//ܼ±¼Ƿ޸ģÿԭӵģбвͬ߳̿ͬʱ
+	class DirtyBits
+	{
+	private:
+		std::unique_ptr<std::atomic<uint64_t>[]> words;
+		size_t wordCount = 0;
+		size_t capacity = 0;
+
+	public:
+		static constexpr size_t WORD_BITS = 64;
+
+		//ֻڽṹʱset
+		void resize(const size_t bits)
 		{
-			std::lock_guard<std::mutex> lockMtx(mtx);
-			if (id >= entityToIndex.size())
-			{
-				return nullptr;
-			}
-			if (entityToIndex[id] == SIZE_MAX)
+			const size_t need = (bits + WORD_BITS - 1) / WORD_BITS;
+			if (need > capacity)
 			{
-				return nullptr;
+				const size_t newCapacity = std::max(need, capacity * 2);
+				std::unique_ptr<std::atomic<uint64_t>[]> newWords(new std::atomic<uint64_t>[newCapacity]);
+				for (size_t i = 0; i < newCapacity; ++i)
+				{
+					newWords[i].store(i < wordCount ? words[i].load(std::memory_order_relaxed) : 0, std::memory_order_relaxed);
+				}
+				words = std::move(newWords);
+				capacity = newCapacity;
 			}
-			else
+			for (size_t i = wordCount; i < need; ++i)
 			{
-				return &dataVector[entityToIndex[id]];
+				words[i].store(0, std::memory_order_relaxed);
 			}
+			wordCount = need;
 		}
-		const T* get(const entity id) const
+		void set(const size_t i)
 		{
-			std::lock_guard<std::mutex> lockMtx(mtx);
-			if (id >= entityToIndex.size())
-			{
-				return nullptr;
-			}
-			if (entityToIndex[id] == SIZE_MAX)
-			{
-				return nullptr;
-			}
-			else
+			const uint64_t mask = uint64_t(1) << (i % WORD_BITS);
+			std::atomic<uint64_t>& word = words[i / WORD_BITS];
+			if ((word.load(std::memory_order_relaxed) & mask) == 0)//ѱʱдû
 			{
-				return &dataVector[entityToIndex[id]];
+				word.fetch_or(mask, std::memory_order_relaxed);
 			}
 		}
-		size_t size() const
+		void reset(const size_t i)
 		{
-			std::lock_guard<std::mutex> lockMtx(mtx);
-			return (dataVector.size());
+			words[i / WORD_BITS].fetch_and(~(uint64_t(1) << (i % WORD_BITS)), std::memory_order_relaxed);
 		}
-		//ά
-		std::unique_lock<std::mutex> getLock()
+		bool test(const size_t i) const
 		{
-			return std::unique_lock<std::mutex>(mtx);
+			return (words[i / WORD_BITS].load(std::memory_order_relaxed) >> (i % WORD_BITS)) & 1;
 		}
-		void reserve(size_t size)
+		void move(const size_t from, const size_t to)//ڽɾĩβԪصıƵλ
 		{
-			std::lock_guard<std::mutex> lockMtx(mtx);
-			dataVector.reserve(size);
-			indexToEntity.reserve(size);
+			if (test(from))
+			{
+				set(to);
+			}
+			else
+			{
+				reset(to);
+			}
+			reset(from);
 		}
-		void clear()
+		//call func(i)±ǵλ
+		template<typename Func>
+		void forEachSet(Func&& func) const
 		{
-			std::lock_guard<std::mutex> lockMtx(mtx);
-			dataVector.clear();
-			indexToEntity.clear();
-			entityToIndex.clear();
+			for (size_t w = 0; w < wordCount; ++w)
+			{
+				uint64_t bits = words[w].load(std::memory_order_relaxed);
+				size_t bit = 0;
+				while (bits)
+				{
+					while (((bits >> bit) & 1) == 0)
+					{
+						++bit;
+					}
+					func(w * WORD_BITS + bit);
+					bits &= bits - 1;
+				}
+			}
 		}
-		void shrink_to_fit()
+		void clear()
 		{
-			std::lock_guard<std::mutex> lockMtx(mtx);
-			dataVector.shrink_to_fit();
-			indexToEntity.shrink_to_fit();
-			while (entityToIndex.back() == SIZE_MAX && !entityToIndex.empty())
+			for (size_t i = 0; i < wordCount; ++i)
 			{
-				entityToIndex.pop_back();
+				words[i].store(0, std::memory_order_relaxed);
 			}
-			entityToIndex.shrink_to_fit();
+		}
+		size_t memoryUsage() const
+		{
+			return capacity * sizeof(uint64_t);
 		}
 	};
 
-	class SystemBase
-	{
-	public:
-		SystemBase() = default;
-		virtual ~SystemBase() = default;
-		virtual void update() = 0;
-	};
-
-	class DrawBase
+	//ҳϡ飺ÿҳ4096λ״дʱ䣬ҳȫΪʱͷ
+	//δҳָͬһֻҳҹ̶Ϊ ҳ->ҳڲλ μӷ
+	class PagedSparseArray
 	{
 	public:
-		DrawBase() = default;
-		virtual ~DrawBase() = default;
-		virtual void draw() = 0;
-	};
+		static constexpr uint64_t EMPTY = UINT64_MAX;
+		static constexpr size_t PAGE_BITS = 12;
+		static constexpr size_t PAGE_SIZE = size_t(1) << PAGE_BITS;
 
-
-	class AABB
-	{
 	private:
-		Vector2 centralPoint;
-		float xHarfLength;
-		float yHarfLength;
+		static constexpr size_t PAGE_MASK = PAGE_SIZE - 1;
 
-	public:
-		AABB() = default;
-		AABB(Vector2 central, float harfX, float harfY) : centralPoint(central), xHarfLength(harfX), yHarfLength(harfY) {}
-		AABB(Vector2 central, float radius) : centralPoint(central), xHarfLength(radius), yHarfLength(radius) {}
+		std::vector<uint64_t*> pages;
+		std::vector<uint32_t> pageLive;//ÿҳǿղλ
+		size_t allocatedPages = 0;
 
-		const Vector2 getPosition() const
-		{
-			return centralPoint;
-		}
-		Vector2 getPosition()
-		{
-			return centralPoint;
-		}
-		const float getXHarfLength() const
+		static uint64_t* nullPage()
 		{
-			return xHarfLength;
+			static const std::vector<uint64_t> page(PAGE_SIZE, EMPTY);
+			return const_cast<uint64_t*>(page.data());//ֻдǰܻȷʵҳ
 		}
-		float getXHarfLength()
+		void freePage(const size_t p)
 		{
-			return xHarfLength;
+			delete[] pages[p];
+			pages[p] = nullPage();
+			pageLive[p] = 0;
+			--allocatedPages;
 		}
-		const float getYHarfLength() const
+
+	public:
+		PagedSparseArray() = default;
+		PagedSparseArray(const PagedSparseArray&) = delete;
+		PagedSparseArray& operator=(const PagedSparseArray&) = delete;
+		~PagedSparseArray()
 		{
-			return yHarfLength;
+			clear();
 		}
-		float getYHarfLength()
+
+		uint64_t get(const size_t index) const
 		{
-			return yHarfLength;
+			const size_t p = index >> PAGE_BITS;
+			return p < pages.size() ? pages[p][index & PAGE_MASK] : EMPTY;
 		}
-		bool isCross(const AABB& other) const
+		void set(const size_t index, const uint64_t value)
 		{
-			if (
-				other.centralPoint.x - other.xHarfLength > centralPoint.x + xHarfLength ||
-				other.centralPoint.x + other.xHarfLength < centralPoint.x - xHarfLength ||
-				other.centralPoint.y - other.yHarfLength > centralPoint.y + yHarfLength ||
-				other.centralPoint.y + other.yHarfLength < centralPoint.y - yHarfLength
-				)
+			const size_t p = index >> PAGE_BITS;
+			if (p >= pages.size())
 			{
-				return false;
+				pages.resize(p + 1, nullPage());
+				pageLive.resize(p + 1, 0);
 			}
-			else
+			if (pages[p] == nullPage())
 			{
-				return true;
+				if (value == EMPTY)
+				{
+					return;
+				}
+				pages[p] = new uint64_t[PAGE_SIZE];
+				std::fill(pages[p], pages[p] + PAGE_SIZE, EMPTY);
+				++allocatedPages;
 			}
-		}
-		bool isIncluding(const AABB& other) const
-		{
-			if (
-				other.centralPoint.x - other.xHarfLength < centralPoint.x - xHarfLength ||
-				other.centralPoint.x + other.xHarfLength > centralPoint.x + xHarfLength ||
-				other.centralPoint.y - other.yHarfLength < centralPoint.y - yHarfLength ||
-				other.centralPoint.y + other.yHarfLength > centralPoint.y + yHarfLength
-				)
+			uint64_t& slot = pages[p][index & PAGE_MASK];
+			if (slot == EMPTY && value != EMPTY)
 			{
-				return false;
+				++pageLive[p];
 			}
-			else
+			else if (slot != EMPTY && value == EMPTY)
 			{
-				return true;
+				--pageLive[p];
+			}
+			slot = value;
+			if (pageLive[p] == 0)
+			{
+				freePage(p);
 			}
 		}
-		bool isIncluding(const Vector2 point) const
+		void reset(const size_t index)
 		{
-			if (
-				point.x < centralPoint.x - xHarfLength ||
-				point.x > centralPoint.x + xHarfLength ||
-				point.y < centralPoint.y - yHarfLength ||
-				point.y > centralPoint.y + yHarfLength
-				)
+			set(index, EMPTY);
+		}
+		void clear()
+		{
+			for (size_t p = 0; p < pages.size(); ++p)
 			{
-				return false;
+				if (pages[p] != nullPage())
+				{
+					freePage(p);
+				}
 			}
-			else
+			pages.clear();
+			pageLive.clear();
+		}
+		void shrink_to_fit()//ȥҳĩβĿҳ
+		{
+			while (!pages.empty() && pages.back() == nullPage())
 			{
-				return true;
+				pages.pop_back();
+				pageLive.pop_back();
 			}
+			pages.shrink_to_fit();
+			pageLive.shrink_to_fit();
+		}
+		size_t pageCount() const
+		{
+			return allocatedPages;
+		}
+		size_t memoryUsage() const
+		{
+			return allocatedPages * PAGE_SIZE * sizeof(uint64_t) + pages.capacity() * sizeof(uint64_t*) + pageLive.capacity() * sizeof(uint32_t);
 		}
 	};
 
-	class QuadTree
+	class ComponentPoolBase
 	{
-	private:
-		AABB selfAABB;
+	protected:
+		SignatureTable* signatureTable = nullptr;
+		size_t signatureType = 0;
 
-		static constexpr uint8_t MAX_LEVEL = 5;
-		static constexpr uint8_t MAX_OBJECTS = 5;
+		void noteAdded(const entity* ids, const size_t count)
+		{
+			if (signatureTable != nullptr)
+			{
+				signatureTable->set(ids, count, signatureType);
+			}
+		}
+	public:
+		ComponentPoolBase() = default;
+		//֮κ;typetableʵǩųMAX_COMPONENT_TYPESͲ¼
+		void trackSignatures(SignatureTable* table, const size_t type)
+		{
+			signatureTable = type < MAX_COMPONENT_TYPES ? table : nullptr;
+			signatureType = type;
+		}
+		virtual ComponentPoolBase& remove(const entity id) = 0;
+		virtual ComponentPoolBase& removeBatch(const entity* ids, const size_t count) = 0;
+		virtual void beginDeferred() = 0;
+		virtual void sync() = 0;
+		virtual const std::vector<entity>& entities() const = 0;
+		virtual ~ComponentPoolBase() = default;
+	};
 
-		std::vector<entity> entityList;
-		std::vector<AABB> aabbList;
+	//ϡ輯صĹ֣ʵܼ±˫ӳ䡢ӳٵĽṹǡ
+	//ֻܼ±꣬Storage±ţAosStorageSoaStorageStorageṩ
+	//push(U&&)set(i, U&&)move(to, from)pop()value(i)reserve(n)clear()shrink_to_fit()memoryUsage()save(out)read(in, count)
+	template<typename T, typename Storage>
+	class DenseComponentPool : public ComponentPoolBase
+	{
+	protected:
+		Storage storage;//indexToEntity±һһӦ
+		std::vector<entity> indexToEntity;
+		PagedSparseArray entityToIndex;
+		DirtyBits dirty;//ܼ±һһӦ
+		std::vector<uint32_t> batchIndices;//removeBatchʱ±
+		mutable std::mutex mtx;
 
-		uint8_t selfLevel = 0;
+		std::atomic<bool> deferred = false;//ֻsync/beginDeferredд룬̲߳ȡ
+		std::vector<std::pair<entity, std::optional<T>>> pending;//ӳٵĽṹnulloptΪƳ
+		std::mutex pendingMtx;
 
-		std::unique_ptr<QuadTree> NE;
-		std::unique_ptr<QuadTree> SE;
-		std::unique_ptr<QuadTree> NW;
-		std::unique_ptr<QuadTree> SW;
+		static constexpr uint64_t EMPTY_SLOT = PagedSparseArray::EMPTY;
 
-	public:
-		QuadTree() = default;
-		QuadTree(AABB aabb, std::vector<entity> entitys, std::vector<AABB> aabbsOfEntity, uint8_t level) : selfAABB(aabb), entityList(entitys), aabbList(aabbsOfEntity), selfLevel(level)
+		//entityToIndexʵ 汾<<32|ܼ±꣬һζȡжϾǷ
+		template<typename U>
+		void addUnlocked(const entity id, U&& dat)
 		{
-			if (entitys.size() > MAX_OBJECTS && level < MAX_LEVEL)
+			const uint32_t index = EntityIndex(id);
+			const uint64_t slot = entityToIndex.get(index);
+			if (slot != EMPTY_SLOT)
 			{
-				split();
+				//ͬһϵľɰ汾ֱӱʵ帲
+				storage.set(EntityIndex(slot), std::forward<U>(dat));
+				indexToEntity[EntityIndex(slot)] = id;
+				entityToIndex.set(index, MakeEntity(EntityIndex(slot), EntityVersion(id)));
+				dirty.reset(EntityIndex(slot));
+				return;
 			}
+			indexToEntity.push_back(id);
+			storage.push(std::forward<U>(dat));
+			dirty.resize(indexToEntity.size());
+			entityToIndex.set(index, MakeEntity(uint32_t(indexToEntity.size() - 1), EntityVersion(id)));
+		}
+		void removeUnlocked(const entity id)
+		{
+			const size_t idx = findIndex(id);
+			if (idx != NOT_FOUND)
+			{
+				removeAt(uint32_t(idx));
+			}
+		}
+		//ɾĩβԪλ
+		void removeAt(const uint32_t idx)
+		{
+			const uint32_t index = EntityIndex(indexToEntity[idx]);
+			const size_t lastIdx = indexToEntity.size() - 1;
+
+			if (idx != lastIdx)
+			{
+				const entity last = indexToEntity[lastIdx];
+				entityToIndex.set(EntityIndex(last), MakeEntity(idx, EntityVersion(last)));
+				storage.move(idx, lastIdx);
+				indexToEntity[idx] = last;
+				dirty.move(lastIdx, idx);
+			}
+			else
+			{
+				dirty.reset(idx);
+			}
+
+			storage.pop();
+			indexToEntity.pop_back();
+			entityToIndex.reset(index);
+		}
+		size_t findIndex(const entity id) const
+		{
+			const uint64_t slot = entityToIndex.get(EntityIndex(id));
+			if (slot == EMPTY_SLOT || EntityVersion(slot) != EntityVersion(id))
+			{
+				return NOT_FOUND;
+			}
+			return EntityIndex(slot);
+		}
+		size_t lockedIndex(const entity id) const//ӳģʽ¼
+		{
+			if (deferred)
+			{
+				return findIndex(id);
+			}
+			std::lock_guard<std::mutex> lockMtx(mtx);
+			return findIndex(id);
+		}
+
+		static constexpr size_t CHUNK_ALIGN = DirtyBits::WORD_BITS;
+		static constexpr size_t CHUNKS_PER_THREAD = 4;
+		size_t grainSize = 1024;
+
+		//Сȡ64Ԫصֽǻеڿ鲻ͬһ
+		size_t chunkSize(const size_t count, const size_t threads) const
+		{
+			const size_t parts = std::max<size_t>(threads, 1) * CHUNKS_PER_THREAD;
+			size_t chunk = std::max((count + parts - 1) / parts, grainSize);
+			return (chunk + CHUNK_ALIGN - 1) / CHUNK_ALIGN * CHUNK_ALIGN;
+		}
+
+	public:
+		static constexpr size_t NOT_FOUND = SIZE_MAX;
+
+		DenseComponentPool() = default;
+
+		DenseComponentPool& add(const entity id, const T& dat)
+		{
+			if (deferred)
+			{
+				std::lock_guard<std::mutex> lockPending(pendingMtx);
+				pending.emplace_back(id, dat);
+				return *this;
+			}
+			std::lock_guard<std::mutex> lockMtx(mtx);
+			addUnlocked(id, dat);
+			noteAdded(&id, 1);
+			return *this;
+		}
+		DenseComponentPool& add(const entity id, T&& dat)
+		{
+			if (deferred)
+			{
+				std::lock_guard<std::mutex> lockPending(pendingMtx);
+				pending.emplace_back(id, std::move(dat));
+				return *this;
+			}
+			std::lock_guard<std::mutex> lockMtx(mtx);
+			addUnlocked(id, std::move(dat));
+			noteAdded(&id, 1);
+			return *this;
+		}
+		//һμcountfirstƶ
+		template<typename It>
+		DenseComponentPool& addBatch(const entity* ids, It first, const size_t count)
+		{
+			if (deferred)
+			{
+				std::lock_guard<std::mutex> lockPending(pendingMtx);
+				pending.reserve(pending.size() + count);
+				for (size_t i = 0; i < count; ++i, ++first)
+				{
+					pending.emplace_back(ids[i], *first);
+				}
+				return *this;
+			}
+			std::lock_guard<std::mutex> lockMtx(mtx);
+			const size_t need = indexToEntity.size() + count;
+			if (indexToEntity.capacity() < need)
+			{
+				const size_t grow = std::max(need, indexToEntity.capacity() * 2);//ּС˻Ϊ
+				storage.reserve(grow);
+				indexToEntity.reserve(grow);
+			}
+			dirty.resize(need);
+			for (size_t i = 0; i < count; ++i, ++first)
+			{
+				addUnlocked(ids[i], *first);
+			}
+			noteAdded(ids, count);
+			return *this;
+		}
+		DenseComponentPool& remove(const entity id) override
+		{
+			if (deferred)
+			{
+				std::lock_guard<std::mutex> lockPending(pendingMtx);
+				pending.emplace_back(id, std::nullopt);
+				return *this;
+			}
+			std::lock_guard<std::mutex> lockMtx(mtx);
+			removeUnlocked(id);
+			return *this;
+		}
+		//һμƳһʵ壺ռܼ±꣬ٴӴСɾ
+		//ӴСʱλĩβԪһڴɾУÿԪƶһ
+		DenseComponentPool& removeBatch(const entity* ids, const size_t count) override
+		{
+			if (deferred)
+			{
+				std::lock_guard<std::mutex> lockPending(pendingMtx);
+				for (size_t i = 0; i < count; ++i)
+				{
+					pending.emplace_back(ids[i], std::nullopt);
+				}
+				return *this;
+			}
+			std::lock_guard<std::mutex> lockMtx(mtx);
+			batchIndices.clear();
+			for (size_t i = 0; i < count; ++i)
+			{
+				const size_t idx = findIndex(ids[i]);
+				if (idx != NOT_FOUND)
+				{
+					batchIndices.push_back(uint32_t(idx));
+				}
+			}
+			std::sort(batchIndices.begin(), batchIndices.end(), std::greater<uint32_t>());
+			batchIndices.erase(std::unique(batchIndices.begin(), batchIndices.end()), batchIndices.end());
+			for (uint32_t idx : batchIndices)
+			{
+				removeAt(idx);
+			}
+			return *this;
+		}
+
+		//뵥д׶Σṹӳٵsync()ڼget/size
+		void beginDeferred() override
+		{
+			std::lock_guard<std::mutex> lockMtx(mtx);
+			deferred = true;
+		}
+		//ͬ㣺ύ˳Ӧӳٵadd/remove˳д׶
+		void sync() override
+		{
+			std::lock_guard<std::mutex> lockMtx(mtx);
+			std::lock_guard<std::mutex> lockPending(pendingMtx);
+			deferred = false;
+			for (auto& p : pending)
+			{
+				if (p.second.has_value())
+				{
+					addUnlocked(p.first, std::move(*p.second));
+					noteAdded(&p.first, 1);
+				}
+				else
+				{
+					removeUnlocked(p.first);
+				}
+			}
+			pending.clear();
+		}
+		bool isDeferred() const
+		{
+			return deferred;
+		}
+
+		//ʵܼ±꣬ʱNOT_FOUNDcontainsһֱӶȡϡ飬
+		//ṹʱֻӳģʽµáat(i)entities()ɲرңViewԴʵ
+		size_t denseIndex(const entity id) const
+		{
+			return findIndex(id);
+		}
+		bool contains(const entity id) const
+		{
+			return findIndex(id) != NOT_FOUND;
+		}
+		//ܼ洢еʵ˳forEach˳һ
+		const std::vector<entity>& entities() const override
+		{
+			return indexToEntity;
+		}
+		size_t size() const
+		{
+			if (deferred)
+			{
+				return indexToEntity.size();
+			}
+			std::lock_guard<std::mutex> lockMtx(mtx);
+			return indexToEntity.size();
+		}
+
+		//call func(begin, end)ܼ߳±г64Ԫض䣬ÿһ
+		template<typename Func>
+		void forEachRange(ThreadPool& tp, Func&& func) const
+		{
+			const size_t count = indexToEntity.size();
+			const size_t chunk = chunkSize(count, tp.threadCount());
+			if (chunk >= count)
+			{
+				func(size_t(0), count);
+				return;
+			}
+			tp.parallelFor(0, (count + chunk - 1) / chunk, 1, [count, chunk, &func](size_t chunkBegin, size_t chunkEnd)
+				{
+					func(chunkBegin * chunk, std::min(chunkEnd * chunk, count));
+				});
+		}
+		void setGrainSize(size_t grain)//бʱÿԪ
+		{
+			grainSize = std::max<size_t>(grain, 1);
+		}
+		size_t getGrainSize() const
+		{
+			return grainSize;
+		}
+
+		bool isDirty(const entity id) const
+		{
+			const size_t idx = lockedIndex(id);
+			return idx != NOT_FOUND && dirty.test(idx);
+		}
+		//ѱǵƵtargetǣظƵ
+		size_t syncDirtyTo(DenseComponentPool& target)
+		{
+			std::scoped_lock lockMtx(mtx, target.mtx);
+			size_t copies = 0;
+			dirty.forEachSet([this, &target, &copies](size_t idx)
+				{
+					const entity id = indexToEntity[idx];
+					const size_t dst = target.findIndex(id);
+					if (dst != NOT_FOUND)
+					{
+						target.storage.set(dst, storage.value(idx));
+					}
+					else
+					{
+						target.addUnlocked(id, storage.value(idx));
+					}
+					++copies;
+				});
+			dirty.clear();
+			return copies;
+		}
+
+		//ά
+		std::unique_lock<std::mutex> getLock()
+		{
+			return std::unique_lock<std::mutex>(mtx);
+		}
+		void reserve(size_t size)
+		{
+			std::lock_guard<std::mutex> lockMtx(mtx);
+			storage.reserve(size);
+			indexToEntity.reserve(size);
+		}
+		void clear()
+		{
+			std::lock_guard<std::mutex> lockMtx(mtx);
+			storage.clear();
+			indexToEntity.clear();
+			entityToIndex.clear();
+			dirty.clear();
+		}
+		void shrink_to_fit()
+		{
+			std::lock_guard<std::mutex> lockMtx(mtx);
+			storage.shrink_to_fit();
+			indexToEntity.shrink_to_fit();
+			entityToIndex.shrink_to_fit();
+		}
+		//ռõֽڲеĶڴ
+		size_t memoryUsage() const
+		{
+			std::lock_guard<std::mutex> lockMtx(mtx);
+			return storage.memoryUsage() + indexToEntity.capacity() * sizeof(entity)
+				+ entityToIndex.memoryUsage() + dirty.memoryUsage();
+		}
+
+		//գֻдʵϡڶȡʱؽҪSerializer<T>ӳٽ׶ε
+		void save(BinaryWriter& out) const
+		{
+			std::lock_guard<std::mutex> lockMtx(mtx);
+			out.writeArray(indexToEntity.data(), indexToEntity.size());
+			storage.save(out);
+		}
+		//һصݣʱ޸κγأնȡɹassign滻
+		struct Loaded
+		{
+			std::vector<entity> ids;
+			Storage data;
+		};
+		static bool read(BinaryReader& in, Loaded& loaded)
+		{
+			return in.readArray(loaded.ids) && loaded.data.read(in, loaded.ids.size());
+		}
+		//滻ȫ
+		void assign(Loaded loaded)
+		{
+			std::lock_guard<std::mutex> lockMtx(mtx);
+			indexToEntity = std::move(loaded.ids);
+			storage = std::move(loaded.data);
+			entityToIndex.clear();
+			dirty.clear();
+			dirty.resize(indexToEntity.size());
+			for (size_t i = 0; i < indexToEntity.size(); ++i)
+			{
+				entityToIndex.set(EntityIndex(indexToEntity[i]), MakeEntity(uint32_t(i), EntityVersion(indexToEntity[i])));
+			}
+		}
+		//滻ȫݣʧʱΪ
+		bool load(BinaryReader& in)
+		{
+			Loaded loaded;
+			const bool result = read(in, loaded);
+			assign(result ? std::move(loaded) : Loaded());
+			return result;
+		}
+	};
+
+	//ṹ飺һvector
+	template<typename T>
+	class AosStorage
+	{
+	public:
+		std::vector<T> values;
+
+		template<typename U>
+		void push(U&& dat)
+		{
+			values.push_back(std::forward<U>(dat));
+		}
+		template<typename U>
+		void set(const size_t i, U&& dat)
+		{
+			values[i] = std::forward<U>(dat);
+		}
+		void move(const size_t to, const size_t from)
+		{
+			values[to] = std::move(values[from]);
+		}
+		void pop()
+		{
+			values.pop_back();
+		}
+		const T& value(const size_t i) const
+		{
+			return values[i];
+		}
+		void reserve(const size_t size)
+		{
+			values.reserve(size);
+		}
+		void clear()
+		{
+			values.clear();
+		}
+		void shrink_to_fit()
+		{
+			values.shrink_to_fit();
+		}
+		size_t memoryUsage() const
+		{
+			return values.capacity() * sizeof(T);
+		}
+		void save(BinaryWriter& out) const
+		{
+			if constexpr (IsPodSerialized<T>)
+			{
+				out.writeArray(values.data(), values.size());
+			}
+			else
+			{
+				for (auto& com : values)
+				{
+					Serializer<T>::write(out, com);
+				}
+			}
+		}
+		bool read(BinaryReader& in, const size_t count)
+		{
+			if constexpr (IsPodSerialized<T>)
+			{
+				return in.readArray(values) && values.size() == count;
+			}
+			else
+			{
+				values.reserve(count);
+				for (size_t i = 0; i < count; ++i)
+				{
+					values.push_back(Serializer<T>::read(in));
+					if (!in.ok())
+					{
+						return false;
+					}
+				}
+				return true;
+			}
+		}
+	};
+
+	//using T = int;
+	template<typename T, typename>
+	class ComponentPool : public DenseComponentPool<T, AosStorage<T>>
+	{
+	private:
+		using Base = DenseComponentPool<T, AosStorage<T>>;
+		using Base::storage;
+		using Base::indexToEntity;
+		using Base::dirty;
+		using Base::mtx;
+		using Base::deferred;
+		using Base::findIndex;
+		using Base::lockedIndex;
+
+	public:
+		using Base::NOT_FOUND;
+
+		ComponentPool() = default;
+
+		//call func(id, Compornent, args...)
+		template<typename Func, typename ...Args>
+		void forEach(Func&& func, Args&& ...args)
+		{
+			for (size_t i = 0; i < storage.values.size(); i++)
+			{
+				std::forward<Func>(func)(indexToEntity[i], storage.values[i], std::forward<Args>(args)...);
+			}
+		}
+		template<typename Func, typename ...Args>
+		void forEach(Func&& func, Args&& ...args) const
+		{
+			for (size_t i = 0; i < storage.values.size(); i++)
+			{
+				std::forward<Func>(func)(indexToEntity[i], storage.values[i], std::forward<Args>(args)...);
+			}
+		}
+
+		//ܼ߳гɰж飬ÿһ
+		template<typename Func, typename ...Args>
+		void forEach(ThreadPool& tp, Func&& func, Args&& ...args)
+		{
+			this->forEachRange(tp, [this, &func, &args...](size_t begin, size_t end)
+				{
+					for (size_t i = begin; i < end; i++)
+					{
+						func(indexToEntity[i], storage.values[i], args...);
+					}
+				});
+		}
+		template<typename Func, typename ...Args>
+		void forEach(ThreadPool& tp, Func&& func, Args&& ...args) const
+		{
+			this->forEachRange(tp, [this, &func, &args...](size_t begin, size_t end)
+				{
+					for (size_t i = begin; i < end; i++)
+					{
+						func(indexToEntity[i], storage.values[i], args...);
+					}
+				});
+		}
+
+		T* get(const entity id)
+		{
+			const size_t idx = lockedIndex(id);
+			return idx == NOT_FOUND ? nullptr : &storage.values[idx];
+		}
+		const T* get(const entity id) const
+		{
+			const size_t idx = lockedIndex(id);
+			return idx == NOT_FOUND ? nullptr : &storage.values[idx];
+		}
+		//ȡΪ޸ģ˫彻ʱֻѱǵͬһ
+		//д壨inactiveδmodifyд벻ᱻͬ
+		T* modify(const entity id)
+		{
+			std::unique_lock<std::mutex> lockMtx(mtx, std::defer_lock);
+			if (!deferred)
+			{
+				lockMtx.lock();
+			}
+			const size_t idx = findIndex(id);
+			if (idx == NOT_FOUND)
+			{
+				return nullptr;
+			}
+			dirty.set(idx);
+			return &storage.values[idx];
+		}
+		//ܼ±ȡ±denseIndexentities()
+		T& at(const size_t index)
+		{
+			return storage.values[index];
+		}
+		const T& at(const size_t index) const
+		{
+			return storage.values[index];
+		}
+	};
+
+	template<typename M>
+	struct MemberTraits;
+	template<typename C, typename F>
+	struct MemberTraits<F C::*>
+	{
+		using Class = C;
+		using Field = F;
+	};
+
+	//ŵĵֶΣϵͳдѭ
+	template<typename F>
+	class FieldSpan
+	{
+	private:
+		F* ptr;
+		size_t count;
+	public:
+		FieldSpan(F* ptr, size_t count) : ptr(ptr), count(count) {}
+		F* data() const { return ptr; }
+		size_t size() const { return count; }
+		F* begin() const { return ptr; }
+		F* end() const { return ptr + count; }
+		F& operator[](size_t i) const { return ptr[i]; }
+	};
+
+	//call func(i)iȡ[begin, end)ÿ8±Ϊһ飬ѭ̶Ϊѭ
+	//GCC-O2ֻʽѭ֤߱ͬ±funcдԷݣֶ黥صɣ
+	template<typename Func>
+	inline void IndependentFor(size_t begin, const size_t end, Func&& func)
+	{
+		constexpr size_t BLOCK = 8;
+		for (; begin + BLOCK <= end; begin += BLOCK)
+		{
+#if defined(_MSC_VER)
+#pragma loop(ivdep)
+#elif defined(__clang__)
+#pragma clang loop vectorize(assume_safety)
+#elif defined(__GNUC__)
+#pragma GCC ivdep
+#endif
+			for (size_t i = begin; i < begin + BLOCK; ++i)
+			{
+				func(i);
+			}
+		}
+		for (; begin < end; ++begin)
+		{
+			func(begin);
+		}
+	}
+
+	//ṹ鲼֣ÿгֶһ
+	template<typename T, auto ...Members>
+	class SoaStorage
+	{
+	public:
+		using Columns = std::tuple<std::vector<typename MemberTraits<decltype(Members)>::Field>...>;
+		using Fields = std::index_sequence_for<decltype(Members)...>;
+		Columns columns;
+
+	private:
+		template<auto A, auto B>
+		static constexpr bool sameMember()
+		{
+			if constexpr (std::is_same_v<decltype(A), decltype(B)>)
+			{
+				return A == B;
+			}
+			else
+			{
+				return false;
+			}
+		}
+		template<size_t ...Is>
+		void pushBack(const T& dat, std::index_sequence<Is...>)
+		{
+			(std::get<Is>(columns).push_back(dat.*Members), ...);
+		}
+		template<size_t ...Is>
+		void storeAt(const size_t idx, const T& dat, std::index_sequence<Is...>)
+		{
+			((std::get<Is>(columns)[idx] = dat.*Members), ...);
+		}
+		template<size_t ...Is>
+		void loadAt(const size_t idx, T& dat, std::index_sequence<Is...>) const
+		{
+			((dat.*Members = std::get<Is>(columns)[idx]), ...);
+		}
+
+	public:
+		template<auto Member>
+		static constexpr size_t fieldIndex()
+		{
+			size_t result = SIZE_MAX;
+			size_t i = 0;
+			((result = (result == SIZE_MAX && sameMember<Member, Members>()) ? i : result, ++i), ...);
+			return result;
+		}
+
+		void push(const T& dat)
+		{
+			pushBack(dat, Fields());
+		}
+		void set(const size_t i, const T& dat)
+		{
+			storeAt(i, dat, Fields());
+		}
+		void move(const size_t to, const size_t from)
+		{
+			std::apply([to, from](auto& ...column) { ((column[to] = column[from]), ...); }, columns);
+		}
+		void pop()
+		{
+			std::apply([](auto& ...column) { (column.pop_back(), ...); }, columns);
+		}
+		T value(const size_t i) const
+		{
+			T result{};
+			loadAt(i, result, Fields());
+			return result;
+		}
+		void reserve(const size_t size)
+		{
+			std::apply([size](auto& ...column) { (column.reserve(size), ...); }, columns);
+		}
+		void clear()
+		{
+			std::apply([](auto& ...column) { (column.clear(), ...); }, columns);
+		}
+		void shrink_to_fit()
+		{
+			std::apply([](auto& ...column) { (column.shrink_to_fit(), ...); }, columns);
+		}
+		size_t memoryUsage() const
+		{
+			size_t bytes = 0;
+			std::apply([&bytes](auto& ...column) { ((bytes += column.capacity() * sizeof(column[0])), ...); }, columns);
+			return bytes;
+		}
+		//ÿֶд
+		void save(BinaryWriter& out) const
+		{
+			std::apply([&out](auto& ...column) { (out.writeArray(column.data(), column.size()), ...); }, columns);
+		}
+		bool read(BinaryReader& in, const size_t count)
+		{
+			return std::apply([&in, count](auto& ...column) { return ((in.readArray(column) && column.size() == count) && ...); }, columns);
+		}
+	};
+
+	//ṹ鲼ֵأÿֶһ飬SoaLayout<T>ѡ
+	//ֻPODδгֶβᱻ洢ṩT*ʽgetͨ±ֶ
+	template<typename T, auto ...Members>
+	class SoaComponentPool : public DenseComponentPool<T, SoaStorage<T, Members...>>
+	{
+		static_assert(std::is_trivially_copyable_v<T> && std::is_default_constructible_v<T>, "SoA pool requires a POD component");
+		static_assert((std::is_base_of_v<typename MemberTraits<decltype(Members)>::Class, T> && ...), "SoA fields must be members of the component");
+
+	private:
+		using Storage = SoaStorage<T, Members...>;
+		using Base = DenseComponentPool<T, Storage>;
+		using Base::storage;
+		using Base::indexToEntity;
+		using Base::dirty;
+		using Base::lockedIndex;
+
+		template<auto Member>
+		using FieldOf = typename MemberTraits<decltype(Member)>::Field;
+
+	public:
+		using Base::NOT_FOUND;
+		using Base::load;
+
+		//ViewʱصԪأֶͨget<&T::x>()÷
+		class Element
+		{
+		private:
+			SoaComponentPool* pool;
+			size_t idx;
+		public:
+			Element(SoaComponentPool* pool, size_t idx) : pool(pool), idx(idx) {}
+			template<auto Member>
+			FieldOf<Member>& get() const
+			{
+				return pool->template field<Member>()[idx];
+			}
+			size_t index() const
+			{
+				return idx;
+			}
+			T load() const
+			{
+				return pool->storage.value(idx);
+			}
+		};
+
+		SoaComponentPool() = default;
+
+		//ʵֶе±꣬ʱNOT_FOUND
+		size_t indexOf(const entity id) const
+		{
+			return lockedIndex(id);
+		}
+		std::optional<T> load(const entity id) const
+		{
+			const size_t idx = indexOf(id);
+			if (idx == NOT_FOUND)
+			{
+				return std::nullopt;
+			}
+			return storage.value(idx);
+		}
+		bool store(const entity id, const T& dat)//дزΪ޸
+		{
+			const size_t idx = modify(id);
+			if (idx == NOT_FOUND)
+			{
+				return false;
+			}
+			storage.set(idx, dat);
+			return true;
+		}
+		//Ϊ޸Ĳ±֮꣬ͨfield()д
+		size_t modify(const entity id)
+		{
+			const size_t idx = indexOf(id);
+			if (idx != NOT_FOUND)
+			{
+				dirty.set(idx);
+			}
+			return idx;
+		}
+		void markDirty(const size_t index)
+		{
+			dirty.set(index);
+		}
+		template<auto Member>
+		FieldSpan<FieldOf<Member>> field()
+		{
+			constexpr size_t I = Storage::template fieldIndex<Member>();
+			static_assert(I != SIZE_MAX, "field is not part of the SoA layout");
+			auto& column = std::get<I>(storage.columns);
+			return FieldSpan<FieldOf<Member>>(column.data(), column.size());
+		}
+		template<auto Member>
+		FieldSpan<const FieldOf<Member>> field() const
+		{
+			constexpr size_t I = Storage::template fieldIndex<Member>();
+			static_assert(I != SIZE_MAX, "field is not part of the SoA layout");
+			auto& column = std::get<I>(storage.columns);
+			return FieldSpan<const FieldOf<Member>>(column.data(), column.size());
+		}
+		//ܼ±ȡԪأ±denseIndexentities()
+		Element at(const size_t index)
+		{
+			return Element(this, index);
+		}
+
+		//call func(id, index)
+		template<typename Func>
+		void forEach(Func&& func) const
+		{
+			for (size_t i = 0; i < indexToEntity.size(); i++)
+			{
+				func(indexToEntity[i], i);
+			}
+		}
+		//call func(index)IndependentForչ-O2¼funcֻܶд±indexֶ
+		template<typename Func>
+		void forEachIndex(Func&& func) const
+		{
+			IndependentFor(0, indexToEntity.size(), func);
+		}
+	};
+
+	//Ĭʹýṹ飻ػSoaLayout<T>̳SoaFieldsɸΪֶδ洢
+	//template<> struct ecs::SoaLayout<Com> : ecs::SoaFields<&Com::x, &Com::y> {};
+	template<typename T>
+	struct SoaLayout
+	{
+		static constexpr bool enabled = false;
+	};
+	template<auto ...Members>
+	struct SoaFields
+	{
+		static constexpr bool enabled = true;
+		template<typename T>
+		using Pool = SoaComponentPool<T, Members...>;
+	};
+
+	template<typename T>
+	class ComponentPool<T, std::enable_if_t<SoaLayout<T>::enabled>> : public SoaLayout<T>::template Pool<T>
+	{
+	};
+
+	//ʵӶأСĳͨdenseIndex
+	//ṹʱӳģʽ£ϵͳִڼ䣩ʹ
+	//صյĲΪat(i)ĽṹΪT&SoAΪSoaComponentPool::Element
+	template<typename ...Ts>
+	class View
+	{
+	private:
+		std::tuple<ComponentPool<Ts>*...> pools;
+
+		template<size_t ...Is>
+		size_t smallest(std::index_sequence<Is...>) const//Сpoolsеλ
+		{
+			const size_t sizes[] = { std::get<Is>(pools)->size()... };
+			return size_t(std::min_element(std::begin(sizes), std::end(sizes)) - std::begin(sizes));
+		}
+		template<size_t D, typename Func, size_t ...Is>
+		void drive(Func& func, std::index_sequence<Is...>)
+		{
+			const std::vector<entity>& driver = std::get<D>(pools)->entities();
+			for (size_t i = 0; i < driver.size(); ++i)
+			{
+				const entity id = driver[i];
+				//ֱʹܼ±꣬زһϡ
+				const size_t index[] = { (Is == D ? i : std::get<Is>(pools)->denseIndex(id))... };
+				if (((index[Is] != NOT_FOUND) && ...))
+				{
+					func(id, std::get<Is>(pools)->at(index[Is])...);
+				}
+			}
+		}
+		template<typename Func, size_t ...Is>
+		void forEachFrom(Func& func, const size_t driver, std::index_sequence<Is...> seq)
+		{
+			((driver == Is ? drive<Is>(func, seq) : void()), ...);
+		}
+
+		static constexpr size_t NOT_FOUND = SIZE_MAX;
+
+	public:
+		View(ComponentPool<Ts>* ...pools) : pools(pools...) {}
+
+		bool valid() const
+		{
+			return std::apply([](auto* ...p) { return ((p != nullptr) && ...); }, pools);
+		}
+		//ޣСصĴС
+		size_t sizeHint() const
+		{
+			if (!valid())
+			{
+				return 0;
+			}
+			return std::apply([](auto* ...p) { return std::min({ p->size()... }); }, pools);
+		}
+
+		//call func(id, Ts&...)
+		template<typename Func>
+		void forEach(Func&& func)
+		{
+			if (!valid())
+			{
+				return;
+			}
+			forEachFrom(func, smallest(std::index_sequence_for<Ts...>()), std::index_sequence_for<Ts...>());
+		}
+	};
+
+	inline const char INPUT_RESOURCE = 0;//룬жȡϵͳִ
+
+	//ϵͳԹԴĶдԴԵַʶDoubleBufferedءͼȣ
+	//δʵϵͳΪռڵ߳ϵִУǰϵͳ
+	//raylibRAIIüԭӵģϵͳ/ҲҪ
+	struct SystemAccess
+	{
+		std::vector<const void*> reads;
+		std::vector<const void*> writes;
+		bool exclusive = true;
+
+		static SystemAccess Shared()
+		{
+			SystemAccess access;
+			access.exclusive = false;
+			return access;
+		}
+		SystemAccess& read(const void* resource)
+		{
+			reads.push_back(resource);
+			return *this;
+		}
+		SystemAccess& write(const void* resource)
+		{
+			writes.push_back(resource);
+			return *this;
+		}
+		SystemAccess& input()
+		{
+			return write(&INPUT_RESOURCE);
+		}
+		bool conflicts(const SystemAccess& other) const
+		{
+			if (exclusive || other.exclusive)
+			{
+				return true;
+			}
+			for (auto w : writes)
+			{
+				if (std::find(other.writes.begin(), other.writes.end(), w) != other.writes.end() ||
+					std::find(other.reads.begin(), other.reads.end(), w) != other.reads.end())
+				{
+					return true;
+				}
+			}
+			for (auto r : reads)
+			{
+				if (std::find(other.writes.begin(), other.writes.end(), r) != other.writes.end())
+				{
+					return true;
+				}
+			}
+			return false;
+		}
+	};
+
+	class SystemBase
+	{
+	public:
+		SystemBase() = default;
+		virtual ~SystemBase() = default;
+		virtual void update() = 0;
+		//Worldֻϵͳб仯ȡһΣصϵͳڱֲ
+		virtual SystemAccess access() const
+		{
+			return SystemAccess();
+		}
+		//е֣RTTIδдʱWorld"system#"SystemTypeId
+		virtual const char* name() const
+		{
+			return nullptr;
+		}
+	};
+
+	//ϵͳ͵ĳܱţWorldֱϵͳλ
+	inline size_t NextSystemTypeId()
+	{
+		static std::atomic<size_t> counter{ 0 };
+		return counter.fetch_add(1, std::memory_order_relaxed);
+	}
+	template<typename T>
+	inline size_t SystemTypeId()
+	{
+		static const size_t id = NextSystemTypeId();
+		return id;
+	}
+
+	class DrawBase
+	{
+	public:
+		DrawBase() = default;
+		virtual ~DrawBase() = default;
+		virtual void draw() = 0;
+	};
+
+
+	class AABB
+	{
+	private:
+		Vector2 centralPoint;
+		float xHarfLength;
+		float yHarfLength;
+
+	public:
+		AABB() = default;
+		AABB(Vector2 central, float harfX, float harfY) : centralPoint(central), xHarfLength(harfX), yHarfLength(harfY) {}
+		AABB(Vector2 central, float radius) : centralPoint(central), xHarfLength(radius), yHarfLength(radius) {}
+
+		const Vector2 getPosition() const
+		{
+			return centralPoint;
+		}
+		Vector2 getPosition()
+		{
+			return centralPoint;
+		}
+		float getXHarfLength() const
+		{
+			return xHarfLength;
+		}
+		float getXHarfLength()
+		{
+			return xHarfLength;
+		}
+		float getYHarfLength() const
+		{
+			return yHarfLength;
+		}
+		float getYHarfLength()
+		{
+			return yHarfLength;
+		}
+		bool isCross(const AABB& other) const
+		{
+			if (
+				other.centralPoint.x - other.xHarfLength > centralPoint.x + xHarfLength ||
+				other.centralPoint.x + other.xHarfLength < centralPoint.x - xHarfLength ||
+				other.centralPoint.y - other.yHarfLength > centralPoint.y + yHarfLength ||
+				other.centralPoint.y + other.yHarfLength < centralPoint.y - yHarfLength
+				)
+			{
+				return false;
+			}
+			else
+			{
+				return true;
+			}
+		}
+		bool isIncluding(const AABB& other) const
+		{
+			if (
+				other.centralPoint.x - other.xHarfLength < centralPoint.x - xHarfLength ||
+				other.centralPoint.x + other.xHarfLength > centralPoint.x + xHarfLength ||
+				other.centralPoint.y - other.yHarfLength < centralPoint.y - yHarfLength ||
+				other.centralPoint.y + other.yHarfLength > centralPoint.y + yHarfLength
+				)
+			{
+				return false;
+			}
+			else
+			{
+				return true;
+			}
+		}
+		bool isIncluding(const Vector2 point) const
+		{
+			if (
+				point.x < centralPoint.x - xHarfLength ||
+				point.x > centralPoint.x + xHarfLength ||
+				point.y < centralPoint.y - yHarfLength ||
+				point.y > centralPoint.y + yHarfLength
+				)
+			{
+				return false;
+			}
+			else
+			{
+				return true;
+			}
+		}
+	};
+
+	//͵λλãmaskΪ0
+	inline uint32_t LowestBit(const uint64_t mask)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward64(&index, mask);
+		return uint32_t(index);
+#else
+		return uint32_t(__builtin_ctzll(mask));
+#endif
+	}
+
+	//һΧcount(<=64)ŵİΧбȽϣkλΪ1ʾktargetཻ
+	//ȽϷʽboxes[k].isCross(target)߽ͬڴʱcenterhalfãλһ
+	inline uint64_t CrossMaskScalar(const float* minX, const float* minY, const float* maxX, const float* maxY, const size_t count, const AABB& target)
+	{
+		const Vector2 c = target.getPosition();
+		const float tMinX = c.x - target.getXHarfLength();
+		const float tMaxX = c.x + target.getXHarfLength();
+		const float tMinY = c.y - target.getYHarfLength();
+		const float tMaxY = c.y + target.getYHarfLength();
+		uint64_t mask = 0;
+		for (size_t i = 0; i < count; ++i)
+		{
+			const bool apart = tMinX > maxX[i] || tMaxX < minX[i] || tMinY > maxY[i] || tMaxY < minY[i];
+			mask |= uint64_t(!apart) << i;
+		}
+		return mask;
+	}
+#ifdef ECS_SIMD_SSE
+	inline uint64_t CrossMaskSse(const float* minX, const float* minY, const float* maxX, const float* maxY, const size_t count, const AABB& target)
+	{
+		const Vector2 c = target.getPosition();
+		const float tMinX = c.x - target.getXHarfLength();
+		const float tMaxX = c.x + target.getXHarfLength();
+		const float tMinY = c.y - target.getYHarfLength();
+		const float tMaxY = c.y + target.getYHarfLength();
+		const __m128 qMinX = _mm_set1_ps(tMinX);
+		const __m128 qMaxX = _mm_set1_ps(tMaxX);
+		const __m128 qMinY = _mm_set1_ps(tMinY);
+		const __m128 qMaxY = _mm_set1_ps(tMaxY);
+		uint64_t mask = 0;
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			//ȽNaNΪ٣жһ
+			__m128 apart = _mm_or_ps(_mm_cmpgt_ps(qMinX, _mm_loadu_ps(maxX + i)), _mm_cmplt_ps(qMaxX, _mm_loadu_ps(minX + i)));
+			apart = _mm_or_ps(apart, _mm_or_ps(_mm_cmpgt_ps(qMinY, _mm_loadu_ps(maxY + i)), _mm_cmplt_ps(qMaxY, _mm_loadu_ps(minY + i))));
+			mask |= uint64_t(~_mm_movemask_ps(apart) & 0xF) << i;
+		}
+		if (i < count)
+		{
+			mask |= CrossMaskScalar(minX + i, minY + i, maxX + i, maxY + i, count - i, target) << i;
+		}
+		return mask;
+	}
+#endif
+#ifdef ECS_SIMD_AVX2
+	inline uint64_t CrossMaskAvx2(const float* minX, const float* minY, const float* maxX, const float* maxY, const size_t count, const AABB& target)
+	{
+		const Vector2 c = target.getPosition();
+		const float tMinX = c.x - target.getXHarfLength();
+		const float tMaxX = c.x + target.getXHarfLength();
+		const float tMinY = c.y - target.getYHarfLength();
+		const float tMaxY = c.y + target.getYHarfLength();
+		const __m256 qMinX = _mm256_set1_ps(tMinX);
+		const __m256 qMaxX = _mm256_set1_ps(tMaxX);
+		const __m256 qMinY = _mm256_set1_ps(tMinY);
+		const __m256 qMaxY = _mm256_set1_ps(tMaxY);
+		uint64_t mask = 0;
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256 apart = _mm256_or_ps(_mm256_cmp_ps(qMinX, _mm256_loadu_ps(maxX + i), _CMP_GT_OQ), _mm256_cmp_ps(qMaxX, _mm256_loadu_ps(minX + i), _CMP_LT_OQ));
+			apart = _mm256_or_ps(apart, _mm256_or_ps(_mm256_cmp_ps(qMinY, _mm256_loadu_ps(maxY + i), _CMP_GT_OQ), _mm256_cmp_ps(qMaxY, _mm256_loadu_ps(minY + i), _CMP_LT_OQ)));
+			mask |= uint64_t(~_mm256_movemask_ps(apart) & 0xFF) << i;
+		}
+		if (i < count)
+		{
+			mask |= CrossMaskSse(minX + i, minY + i, maxX + i, maxY + i, count - i, target) << i;
+		}
+		return mask;
+	}
+#endif
+	inline uint64_t CrossMask(const float* minX, const float* minY, const float* maxX, const float* maxY, const size_t count, const AABB& target)
+	{
+#if defined(ECS_SIMD_AVX2)
+		return CrossMaskAvx2(minX, minY, maxX, maxY, count, target);
+#elif defined(ECS_SIMD_SSE)
+		return CrossMaskSse(minX, minY, maxX, maxY, count, target);
+#else
+		return CrossMaskScalar(minX, minY, maxX, maxY, count, target);
+#endif
+	}
+
+	//ֿŵһΧУһΧΧеཻ
+	class AabbBatch
+	{
+	private:
+		std::vector<float> minX;
+		std::vector<float> minY;
+		std::vector<float> maxX;
+		std::vector<float> maxY;
+
+	public:
+		void push(const AABB& aabb)
+		{
+			const Vector2 c = aabb.getPosition();
+			minX.push_back(c.x - aabb.getXHarfLength());
+			minY.push_back(c.y - aabb.getYHarfLength());
+			maxX.push_back(c.x + aabb.getXHarfLength());
+			maxY.push_back(c.y + aabb.getYHarfLength());
+		}
+		void set(const size_t index, const AABB& aabb)
+		{
+			const Vector2 c = aabb.getPosition();
+			minX[index] = c.x - aabb.getXHarfLength();
+			minY[index] = c.y - aabb.getYHarfLength();
+			maxX[index] = c.x + aabb.getXHarfLength();
+			maxY[index] = c.y + aabb.getYHarfLength();
+		}
+		void copy(const size_t dst, const size_t src)
+		{
+			minX[dst] = minX[src];
+			minY[dst] = minY[src];
+			maxX[dst] = maxX[src];
+			maxY[dst] = maxY[src];
+		}
+		void swapRemove(const size_t index)//һindex˳ı
+		{
+			minX[index] = minX.back();
+			minY[index] = minY.back();
+			maxX[index] = maxX.back();
+			maxY[index] = maxY.back();
+			minX.pop_back();
+			minY.pop_back();
+			maxX.pop_back();
+			maxY.pop_back();
+		}
+		void clear()
+		{
+			minX.clear();
+			minY.clear();
+			maxX.clear();
+			maxY.clear();
+		}
+		void reserve(const size_t count)
+		{
+			minX.reserve(count);
+			minY.reserve(count);
+			maxX.reserve(count);
+			maxY.reserve(count);
+		}
+		void resize(const size_t count)
+		{
+			minX.resize(count);
+			minY.resize(count);
+			maxX.resize(count);
+			maxY.resize(count);
+		}
+		size_t size() const
+		{
+			return minX.size();
+		}
+		//[begin, begin + count)targetཻλ룬count64
+		uint64_t crossMask(const AABB& target, const size_t begin, const size_t count) const
+		{
+			return CrossMask(minX.data() + begin, minY.data() + begin, maxX.data() + begin, maxY.data() + begin, count, target);
+		}
+		//λ룬ÿ64һ
+		void crossMask(const AABB& target, std::vector<uint64_t>& mask) const
+		{
+			const size_t n = size();
+			mask.resize((n + 63) / 64);
+			for (size_t w = 0; w < mask.size(); ++w)
+			{
+				mask[w] = crossMask(target, w * 64, std::min<size_t>(64, n - w * 64));
+			}
+		}
+		//ཻ±갴׷ӵout׷ӵĸ
+		size_t crossIndices(const AABB& target, std::vector<uint32_t>& out) const
+		{
+			const size_t n = size();
+			const size_t before = out.size();
+			for (size_t base = 0; base < n; base += 64)
+			{
+				for (uint64_t mask = crossMask(target, base, std::min<size_t>(64, n - base)); mask != 0; mask &= mask - 1)
+				{
+					out.push_back(uint32_t(base + LowestBit(mask)));
+				}
+			}
+			return out.size() - before;
+		}
+	};
+
+	//ƽ洢ĲڵĿһУĸӽڵ䣬յӽڵɸ
+	//ĿȫڵУmoveڵ㲻ʱԭظ£ֻѸĿƵ½ڵ
+	//ÿڵĿռõslotsboxesеһ䣬Χаţѯʱཻ
+	class QuadTree
+	{
+	private:
+		static constexpr uint8_t MAX_LEVEL = 5;
+		static constexpr uint8_t MAX_OBJECTS = 5;
+		static constexpr uint8_t MERGE_OBJECTS = 2;//ĿֵʱϲֵⷴѺϲ
+		static constexpr uint32_t NONE = UINT32_MAX;
+		static constexpr uint32_t MIN_CAPACITY = 8;//ڵСMIN_CAPACITY2ݱ
+
+		struct Node
+		{
+			AABB bounds;
+			uint32_t parent = NONE;
+			uint32_t firstChild = NONE;//ĸӽڵţ˳ΪNENWSWSE
+			uint32_t first = 0;//ڵĿΪslots[first, first + count)
+			uint32_t count = 0;
+			uint32_t capacity = 0;
+			uint32_t total = 0;//Ŀ
+			uint8_t level = 0;
+		};
+		struct Item
+		{
+			AABB bounds;
+			entity id = NULL_ENTITY;
+			uint32_t node = NONE;
+			uint32_t slot = NONE;//slotsеλ
+		};
+
+		std::vector<Node> nodes;//nodes[0]Ϊ
+		std::vector<uint32_t> freeBlocks;
+		std::vector<Item> items;
+		std::vector<uint32_t> freeItems;
+		std::vector<uint32_t> slots;//ڵеĿ±꣬λͬһ
+		AabbBatch boxes;//slotsһһӦ
+		std::vector<uint32_t> freeRanges;//ּĿͷ
+		PagedSparseArray entityToItem;//ʵ -> 汾<<32|Ŀ±
+
+		static uint32_t RangeClass(uint32_t capacity)
+		{
+			uint32_t c = 0;
+			for (; capacity > MIN_CAPACITY; capacity >>= 1)
+			{
+				++c;
+			}
+			return c;
+		}
+		uint32_t allocRange(const uint32_t capacity)
+		{
+			const uint32_t c = RangeClass(capacity);
+			if (c < freeRanges.size() && freeRanges[c] != NONE)
+			{
+				const uint32_t first = freeRanges[c];
+				freeRanges[c] = slots[first];
+				return first;
+			}
+			const uint32_t first = uint32_t(slots.size());
+			slots.resize(first + capacity);
+			boxes.resize(first + capacity);
+			return first;
+		}
+		void freeRange(const uint32_t first, const uint32_t capacity)
+		{
+			const uint32_t c = RangeClass(capacity);
+			if (c >= freeRanges.size())
+			{
+				freeRanges.resize(c + 1, NONE);
+			}
+			slots[first] = freeRanges[c];
+			freeRanges[c] = first;
+		}
+		//ڵʱӱ
+		void grow(const uint32_t node)
+		{
+			const uint32_t capacity = nodes[node].capacity == 0 ? MIN_CAPACITY : nodes[node].capacity * 2;
+			const uint32_t first = allocRange(capacity);
+			Node& n = nodes[node];
+			for (uint32_t k = 0; k < n.count; ++k)
+			{
+				const uint32_t item = slots[n.first + k];
+				slots[first + k] = item;
+				boxes.copy(first + k, n.first + k);
+				items[item].slot = first + k;
+			}
+			if (n.capacity != 0)
+			{
+				freeRange(n.first, n.capacity);
+			}
+			n.first = first;
+			n.capacity = capacity;
+		}
+		uint32_t findItem(const entity id) const
+		{
+			const uint64_t slot = entityToItem.get(EntityIndex(id));
+			if (slot == PagedSparseArray::EMPTY || EntityVersion(slot) != EntityVersion(id))
+			{
+				return NONE;
+			}
+			return EntityIndex(slot);
+		}
+		void link(const uint32_t item, const uint32_t node)
+		{
+			if (nodes[node].count == nodes[node].capacity)
+			{
+				grow(node);
+			}
+			Item& it = items[item];
+			Node& n = nodes[node];
+			it.node = node;
+			it.slot = n.first + n.count++;
+			slots[it.slot] = item;
+			boxes.set(it.slot, it.bounds);
+			for (uint32_t p = node; p != NONE; p = nodes[p].parent)
+			{
+				++nodes[p].total;
+			}
+		}
+		void unlink(const uint32_t item)
+		{
+			Item& it = items[item];
+			Node& n = nodes[it.node];
+			const uint32_t last = n.first + --n.count;
+			if (it.slot != last)
+			{
+				slots[it.slot] = slots[last];
+				boxes.copy(it.slot, last);
+				items[slots[last]].slot = it.slot;
+			}
+			for (uint32_t p = it.node; p != NONE; p = nodes[p].parent)
+			{
+				--nodes[p].total;
+			}
+			it.node = NONE;
+			it.slot = NONE;
 		}
-
-		void split()
+		uint32_t childFor(const uint32_t node, const AABB& aabb) const
 		{
-			float dx = selfAABB.getXHarfLength() * 0.5f;
-			float dy = selfAABB.getYHarfLength() * 0.5f;
-			std::vector<entity> argEntityList[4];
-			std::vector<AABB> argAABBList[4];
-
-			AABB aabbs[4] =
+			const uint32_t first = nodes[node].firstChild;
+			if (first == NONE)
 			{
+				return NONE;
+			}
+			for (uint32_t i = 0; i < 4; ++i)
+			{
+				if (nodes[first + i].bounds.isIncluding(aabb))
 				{
-					{
-					selfAABB.getPosition().x + dx,
-					selfAABB.getPosition().y + dy
-					},dx,dy
-				},
-				{
-					{
-					selfAABB.getPosition().x - dx,
-					selfAABB.getPosition().y + dy
-					},dx,dy
-				},
-				{
-					{
-					selfAABB.getPosition().x - dx,
-					selfAABB.getPosition().y - dy
-					},dx,dy
-				},
-				{
-					{
-					selfAABB.getPosition().x + dx,
-					selfAABB.getPosition().y - dy
-					},dx,dy
+					return first + i;
 				}
+			}
+			return NONE;
+		}
+		//nodeҵȫaabbڵ
+		uint32_t place(uint32_t node, const AABB& aabb) const
+		{
+			for (uint32_t child = childFor(node, aabb); child != NONE; child = childFor(node, aabb))
+			{
+				node = child;
+			}
+			return node;
+		}
+		void insert(const uint32_t item, const uint32_t node)
+		{
+			link(item, node);
+			const Node& n = nodes[node];
+			if (n.firstChild == NONE && n.count > MAX_OBJECTS && n.level < MAX_LEVEL)
+			{
+				split(node);
+			}
+		}
+		//һαѱڵܷӽڵĿȥ
+		void split(const uint32_t node)
+		{
+			uint32_t first;
+			if (!freeBlocks.empty())
+			{
+				first = freeBlocks.back();
+				freeBlocks.pop_back();
+			}
+			else
+			{
+				first = uint32_t(nodes.size());
+				nodes.resize(nodes.size() + 4);
+			}
+			const AABB& bounds = nodes[node].bounds;
+			const float dx = bounds.getXHarfLength() * 0.5f;
+			const float dy = bounds.getYHarfLength() * 0.5f;
+			const Vector2 center = bounds.getPosition();
+			const AABB quads[4] =
+			{
+				{ { center.x + dx, center.y + dy }, dx, dy },
+				{ { center.x - dx, center.y + dy }, dx, dy },
+				{ { center.x - dx, center.y - dy }, dx, dy },
+				{ { center.x + dx, center.y - dy }, dx, dy }
 			};
-			for (int i = 0; i < entityList.size();)
+			for (uint32_t i = 0; i < 4; ++i)
 			{
-				if (aabbs[0].isIncluding(aabbList[i]))
-				{
-					argAABBList[0].push_back(aabbList[i]);
-					argEntityList[0].push_back(entityList[i]);
-					aabbList.erase(aabbList.begin() + i);
-					entityList.erase(entityList.begin() + i);
-				}
-				else if (aabbs[1].isIncluding(aabbList[i]))
+				//յĿѾΪգԭе
+				Node& c = nodes[first + i];
+				c.bounds = quads[i];
+				c.parent = node;
+				c.firstChild = NONE;
+				c.total = 0;
+				c.level = nodes[node].level + 1;
+			}
+			nodes[node].firstChild = first;
+
+			//ӺǰߵλֻᱻѾĿ
+			for (uint32_t k = nodes[node].count; k-- > 0;)
+			{
+				const uint32_t item = slots[nodes[node].first + k];
+				const uint32_t child = childFor(node, items[item].bounds);
+				if (child != NONE)
 				{
-					argAABBList[1].push_back(aabbList[i]);
-					argEntityList[1].push_back(entityList[i]);
-					aabbList.erase(aabbList.begin() + i);
-					entityList.erase(entityList.begin() + i);
+					unlink(item);
+					link(item, child);
 				}
-				else if (aabbs[2].isIncluding(aabbList[i]))
+			}
+			for (uint32_t i = 0; i < 4; ++i)
+			{
+				const Node& c = nodes[first + i];
+				if (c.count > MAX_OBJECTS && c.level < MAX_LEVEL)
 				{
-					argAABBList[2].push_back(aabbList[i]);
-					argEntityList[2].push_back(entityList[i]);
-					aabbList.erase(aabbList.begin() + i);
-					entityList.erase(entityList.begin() + i);
+					split(first + i);
 				}
-				else if (aabbs[3].isIncluding(aabbList[i]))
+			}
+		}
+		//еĿȫջnodeӽڵ
+		void collapse(const uint32_t node)
+		{
+			const uint32_t first = nodes[node].firstChild;
+			if (first == NONE)
+			{
+				return;
+			}
+			for (uint32_t i = 0; i < 4; ++i)
+			{
+				collapse(first + i);
+				while (nodes[first + i].count != 0)
 				{
-					argAABBList[3].push_back(aabbList[i]);
-					argEntityList[3].push_back(entityList[i]);
-					aabbList.erase(aabbList.begin() + i);
-					entityList.erase(entityList.begin() + i);
+					const Node& c = nodes[first + i];
+					const uint32_t item = slots[c.first + c.count - 1];
+					unlink(item);
+					link(item, node);
 				}
-				else
+			}
+			nodes[node].firstChild = NONE;
+			freeBlocks.push_back(first);
+		}
+		//nodeҵĿ㹻ٵȲϲ
+		void shrink(uint32_t node)
+		{
+			uint32_t target = NONE;
+			for (; node != NONE; node = nodes[node].parent)
+			{
+				if (nodes[node].firstChild != NONE && nodes[node].total <= MERGE_OBJECTS)
 				{
-					i++;
+					target = node;
 				}
 			}
-			NE = std::make_unique<QuadTree>(aabbs[0], std::move(argEntityList[0]), std::move(argAABBList[0]), selfLevel + 1);
-			NW = std::make_unique<QuadTree>(aabbs[1], std::move(argEntityList[1]), std::move(argAABBList[1]), selfLevel + 1);
-			SW = std::make_unique<QuadTree>(aabbs[2], std::move(argEntityList[2]), std::move(argAABBList[2]), selfLevel + 1);
-			SE = std::make_unique<QuadTree>(aabbs[3], std::move(argEntityList[3]), std::move(argAABBList[3]), selfLevel + 1);
+			if (target != NONE)
+			{
+				collapse(target);
+			}
 		}
-		void query(const AABB& targetAABB, std::vector<entity>& result)
+		void queryNode(const uint32_t node, const AABB& targetAABB, std::vector<entity>& result) const
 		{
-			if (!selfAABB.isCross(targetAABB))
+			const Node& n = nodes[node];
+			if (n.total == 0 || (node != 0 && !n.bounds.isCross(targetAABB)))
 			{
 				return;
 			}
-			else
+			const size_t end = n.first + n.count;
+			for (size_t base = n.first; base < end; base += 64)
 			{
-				for (auto e : entityList)
+				for (uint64_t mask = boxes.crossMask(targetAABB, base, std::min<size_t>(64, end - base)); mask != 0; mask &= mask - 1)
 				{
-					result.push_back(e);
+					result.push_back(items[slots[base + LowestBit(mask)]].id);
 				}
-				if (NE)
+			}
+			if (n.firstChild != NONE)
+			{
+				for (uint32_t i = 0; i < 4; ++i)
 				{
-					NE->query(targetAABB, result);
-					NW->query(targetAABB, result);
-					SW->query(targetAABB, result);
-					SE->query(targetAABB, result);
+					queryNode(n.firstChild + i, targetAABB, result);
 				}
 			}
 		}
-		void query(entity id, std::vector<entity>& result)
+
+	public:
+		QuadTree() : nodes(1) {}
+		explicit QuadTree(AABB aabb) : nodes(1)
+		{
+			nodes[0].bounds = aabb;
+		}
+		QuadTree(AABB aabb, const std::vector<entity>& entitys, const std::vector<AABB>& aabbsOfEntity, uint8_t level = 0) : nodes(1)
 		{
-			for (size_t i = 0; i < entityList.size(); ++i)
+			nodes[0].bounds = aabb;
+			nodes[0].level = level;
+			items.reserve(entitys.size());
+			for (size_t i = 0; i < entitys.size() && i < aabbsOfEntity.size(); ++i)
 			{
-				if (entityList[i] == id)
-				{
-					query(aabbList[i], result);
-					return;
-				}
+				add(entitys[i], aabbsOfEntity[i]);
 			}
-			if (NE)
+		}
+
+		//targetAABBཻĿڵ㷶ΧĿҲᱻ
+		void query(const AABB& targetAABB, std::vector<entity>& result) const
+		{
+			queryNode(0, targetAABB, result);
+		}
+		void query(entity id, std::vector<entity>& result) const
+		{
+			const uint32_t item = findItem(id);
+			if (item != NONE)
 			{
-				NE->query(id, result);
-				NW->query(id, result);
-				SW->query(id, result);
-				SE->query(id, result);
+				query(items[item].bounds, result);
 			}
 		}
+		//Ѵڵʵͬmove
 		void add(entity id, AABB aabb)
 		{
-			if (NE)
+			if (findItem(id) != NONE)
 			{
-				if (NE->selfAABB.isIncluding(aabb))
-				{
-					NE->add(id, aabb);
-				}
-				else if (NW->selfAABB.isIncluding(aabb))
-				{
-					NW->add(id, aabb);
-				}
-				else if (SW->selfAABB.isIncluding(aabb))
+				move(id, aabb);
+				return;
+			}
+			uint32_t item;
+			if (!freeItems.empty())
+			{
+				item = freeItems.back();
+				freeItems.pop_back();
+			}
+			else
+			{
+				item = uint32_t(items.size());
+				items.emplace_back();
+			}
+			items[item].bounds = aabb;
+			items[item].id = id;
+			entityToItem.set(EntityIndex(id), MakeEntity(item, EntityVersion(id)));
+			insert(item, place(0, aabb));
+		}
+		bool remove(entity id)
+		{
+			const uint32_t item = findItem(id);
+			if (item == NONE)
+			{
+				return false;
+			}
+			const uint32_t node = items[item].node;
+			unlink(item);
+			items[item].id = NULL_ENTITY;
+			freeItems.push_back(item);
+			entityToItem.reset(EntityIndex(id));
+			shrink(node);
+			return true;
+		}
+		//ҵ԰·ΧĽڵ㣬Ľڵ㣻ڵ㲻ʱκ
+		bool move(entity id, AABB aabb)
+		{
+			const uint32_t item = findItem(id);
+			if (item == NONE)
+			{
+				return false;
+			}
+			items[item].bounds = aabb;
+			const uint32_t from = items[item].node;
+			uint32_t node = from;
+			while (node != 0 && !nodes[node].bounds.isIncluding(aabb))
+			{
+				node = nodes[node].parent;
+			}
+			node = place(node, aabb);
+			if (node != from)
+			{
+				unlink(item);
+				insert(item, node);
+				shrink(from);
+			}
+			else
+			{
+				boxes.set(items[item].slot, aabb);
+			}
+			return true;
+		}
+		bool contains(entity id) const
+		{
+			return findItem(id) != NONE;
+		}
+		size_t size() const
+		{
+			return nodes[0].total;
+		}
+		size_t nodeCount() const//ʹõĽڵ
+		{
+			return nodes.size() - freeBlocks.size() * 4;
+		}
+		void destroy()//Ŀڵ㷶Χӽڵȫգڵؽʱ
+		{
+			for (Node& n : nodes)
+			{
+				n.count = 0;
+				n.firstChild = NONE;
+				n.total = 0;
+			}
+			freeBlocks.clear();
+			for (size_t first = nodes.size(); first > 1; first -= 4)
+			{
+				freeBlocks.push_back(uint32_t(first - 4));
+			}
+			items.clear();
+			freeItems.clear();
+			entityToItem.clear();
+		}
+	};
+
+	//ĲΧĵMortonĿųһ飬ÿ֡ûؽ
+	//ѯĿ귶ΧֽΪ䣬ǺѡĿҪȷʱforEachquery(AABB, vector)
+	class LinearQuadTree
+	{
+	public:
+		struct Span
+		{
+			uint32_t begin;
+			uint32_t end;
+		};
+
+	private:
+		static constexpr uint32_t GRID_BITS = 10;
+		static constexpr uint32_t GRID = 1u << GRID_BITS;//ÿĸ
+		static constexpr uint32_t RADIX_BITS = GRID_BITS;//򸲸2*GRID_BITSλļ
+		static constexpr uint32_t RADIX = 1u << RADIX_BITS;
+		static constexpr uint32_t MAX_OBJECTS = 32;//Ŀڴʱϸ
+
+		AABB bounds;
+		float minX = 0.0f;
+		float minY = 0.0f;
+		float scaleX = 0.0f;
+		float scaleY = 0.0f;
+		float maxHalfX = 0.0f;//Ŀֵѯʱ˷ſΧ
+		float maxHalfY = 0.0f;
+
+		std::vector<uint32_t> keys;//
+		std::vector<entity> ids;
+		std::vector<AABB> boxes;
+
+		std::vector<uint32_t> keyScratch;
+		std::vector<uint32_t> order;
+		std::vector<uint32_t> orderScratch;
+		std::vector<uint32_t> histogram;
+
+		static uint32_t SpreadBits(uint32_t v)
+		{
+			v &= 0x0000FFFF;
+			v = (v | (v << 8)) & 0x00FF00FF;
+			v = (v | (v << 4)) & 0x0F0F0F0F;
+			v = (v | (v << 2)) & 0x33333333;
+			v = (v | (v << 1)) & 0x55555555;
+			return v;
+		}
+		uint32_t cellX(const float x) const
+		{
+			const float c = (x - minX) * scaleX;
+			return c <= 0.0f ? 0 : (c >= float(GRID - 1) ? GRID - 1 : uint32_t(c));
+		}
+		uint32_t cellY(const float y) const
+		{
+			const float c = (y - minY) * scaleY;
+			return c <= 0.0f ? 0 : (c >= float(GRID - 1) ? GRID - 1 : uint32_t(c));
+		}
+		//λǰ˼orderΪԭ±
+		void radixSort(const size_t count)
+		{
+			order.resize(count);
+			orderScratch.resize(count);
+			keyScratch.resize(count);
+			histogram.resize(RADIX);
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				order[i] = i;
+			}
+			for (uint32_t shift = 0; shift < 2 * GRID_BITS; shift += RADIX_BITS)
+			{
+				std::fill(histogram.begin(), histogram.end(), 0);
+				for (size_t i = 0; i < count; ++i)
 				{
-					SW->add(id, aabb);
+					++histogram[(keys[i] >> shift) & (RADIX - 1)];
 				}
-				else if (SE->selfAABB.isIncluding(aabb))
+				uint32_t sum = 0;
+				for (auto& h : histogram)
 				{
-					SE->add(id, aabb);
+					const uint32_t c = h;
+					h = sum;
+					sum += c;
 				}
-				else
+				for (size_t i = 0; i < count; ++i)
 				{
-					entityList.push_back(id);
-					aabbList.push_back(aabb);
+					const uint32_t dst = histogram[(keys[i] >> shift) & (RADIX - 1)]++;
+					keyScratch[dst] = keys[i];
+					orderScratch[dst] = order[i];
 				}
+				keys.swap(keyScratch);
+				order.swap(orderScratch);
 			}
-			else
+		}
+		//(x, y, size)ΪMorton˳µһθӿ飬Ŀλ[lo, hi)
+		//鱻ѯӷΧȫѵӻĿMAX_OBJECTSʱcall emit(begin, end)ĺѡɾȷų
+		//䰴˳һص
+		template<typename Emit>
+		void collect(const uint32_t x, const uint32_t y, const uint32_t size, const uint32_t code,
+			const uint32_t qx0, const uint32_t qy0, const uint32_t qx1, const uint32_t qy1, const uint32_t lo, const uint32_t hi, Emit& emit) const
+		{
+			if (lo == hi || x > qx1 || y > qy1 || x + size - 1 < qx0 || y + size - 1 < qy0)
+			{
+				return;
+			}
+			if (size == 1 || hi - lo <= MAX_OBJECTS || (x >= qx0 && y >= qy0 && x + size - 1 <= qx1 && y + size - 1 <= qy1))
+			{
+				emit(lo, hi);
+				return;
+			}
+			const uint32_t half = size / 2;
+			const uint32_t quarter = half * half;
+			const auto first = keys.begin();
+			const uint32_t m1 = uint32_t(std::lower_bound(first + lo, first + hi, code + quarter) - first);
+			const uint32_t m2 = uint32_t(std::lower_bound(first + m1, first + hi, code + 2 * quarter) - first);
+			const uint32_t m3 = uint32_t(std::lower_bound(first + m2, first + hi, code + 3 * quarter) - first);
+			collect(x, y, half, code, qx0, qy0, qx1, qy1, lo, m1, emit);
+			collect(x + half, y, half, code + quarter, qx0, qy0, qx1, qy1, m1, m2, emit);
+			collect(x, y + half, half, code + 2 * quarter, qx0, qy0, qx1, qy1, m2, m3, emit);
+			collect(x + half, y + half, half, code + 3 * quarter, qx0, qy0, qx1, qy1, m3, hi, emit);
+		}
+		template<typename Emit>
+		void collect(const AABB& targetAABB, Emit&& emit) const
+		{
+			if (keys.empty())
+			{
+				return;
+			}
+			const Vector2 p = targetAABB.getPosition();
+			const float hx = targetAABB.getXHarfLength() + maxHalfX;
+			const float hy = targetAABB.getYHarfLength() + maxHalfY;
+			collect(0, 0, GRID, 0, cellX(p.x - hx), cellY(p.y - hy), cellX(p.x + hx), cellY(p.y + hy), 0, uint32_t(keys.size()), emit);
+		}
+
+	public:
+		LinearQuadTree() = default;
+		explicit LinearQuadTree(AABB aabb)
+		{
+			setBounds(aabb);
+		}
+		//ΧĿ߽ϵĸӣܱѯ
+		void setBounds(AABB aabb)
+		{
+			bounds = aabb;
+			minX = aabb.getPosition().x - aabb.getXHarfLength();
+			minY = aabb.getPosition().y - aabb.getYHarfLength();
+			scaleX = aabb.getXHarfLength() > 0.0f ? float(GRID) / (2.0f * aabb.getXHarfLength()) : 0.0f;
+			scaleY = aabb.getYHarfLength() > 0.0f ? float(GRID) / (2.0f * aabb.getYHarfLength()) : 0.0f;
+		}
+		const AABB& getBounds() const
+		{
+			return bounds;
+		}
+
+		void rebuild(const entity* entitys, const AABB* aabbs, const size_t count)
+		{
+			keys.resize(count);
+			maxHalfX = 0.0f;
+			maxHalfY = 0.0f;
+			for (size_t i = 0; i < count; ++i)
+			{
+				const Vector2 p = aabbs[i].getPosition();
+				keys[i] = SpreadBits(cellX(p.x)) | (SpreadBits(cellY(p.y)) << 1);
+				maxHalfX = std::max(maxHalfX, aabbs[i].getXHarfLength());
+				maxHalfY = std::max(maxHalfY, aabbs[i].getYHarfLength());
+			}
+			radixSort(count);
+			ids.resize(count);
+			boxes.resize(count);
+			for (size_t i = 0; i < count; ++i)
 			{
-				entityList.push_back(id);
-				aabbList.push_back(aabb);
-				if (entityList.size() > MAX_OBJECTS && selfLevel < MAX_LEVEL)
+				ids[i] = entitys[order[i]];
+				boxes[i] = aabbs[order[i]];
+			}
+		}
+		void rebuild(const std::vector<entity>& entitys, const std::vector<AABB>& aabbs)
+		{
+			rebuild(entitys.data(), aabbs.data(), std::min(entitys.size(), aabbs.size()));
+		}
+		void clear()
+		{
+			keys.clear();
+			ids.clear();
+			boxes.clear();
+			maxHalfX = 0.0f;
+			maxHalfY = 0.0f;
+		}
+
+		//targetAABBཻĿ׷ӵspansѺϲ
+		void query(const AABB& targetAABB, std::vector<Span>& spans) const
+		{
+			const size_t first = spans.size();
+			collect(targetAABB, [&spans, first](uint32_t begin, uint32_t end)
 				{
-					split();
-				}
+					if (spans.size() > first && spans.back().end == begin)
+					{
+						spans.back().end = end;
+					}
+					else
+					{
+						spans.push_back(Span{ begin, end });
+					}
+				});
+		}
+		//һδѯΪCSR֣iѯΪspans[offsets[i], offsets[i + 1])
+		void queryBatch(const AABB* targets, const size_t count, std::vector<Span>& spans, std::vector<uint32_t>& offsets) const
+		{
+			spans.clear();
+			offsets.resize(count + 1);
+			offsets[0] = 0;
+			for (size_t i = 0; i < count; ++i)
+			{
+				query(targets[i], spans);
+				offsets[i + 1] = uint32_t(spans.size());
 			}
 		}
-		void destroy()
+		//ȷcall func(id, aabb)
+		template<typename Func>
+		void forEach(const AABB& targetAABB, Func&& func) const
+		{
+			collect(targetAABB, [this, &targetAABB, &func](uint32_t begin, uint32_t end)
+				{
+					for (uint32_t i = begin; i < end; ++i)
+					{
+						if (boxes[i].isCross(targetAABB))
+						{
+							func(ids[i], boxes[i]);
+						}
+					}
+				});
+		}
+		void query(const AABB& targetAABB, std::vector<entity>& result) const
+		{
+			forEach(targetAABB, [&result](entity id, const AABB&) { result.push_back(id); });
+		}
+
+		//Morton˳еĿSpanе±ָ
+		const entity* entities() const
+		{
+			return ids.data();
+		}
+		const AABB* aabbs() const
+		{
+			return boxes.data();
+		}
+		size_t size() const
+		{
+			return ids.size();
+		}
+	};
+
+	//ͳе֣RTTIػComponentName<T>valueָ
+	//δָʱлSerializer<T>::nameΪ"component#"ComponentTypeId
+	template<typename T>
+	struct ComponentName
+	{
+		static constexpr const char* value = nullptr;
+	};
+	template<typename T>
+	std::string ComponentNameOf()
+	{
+		if constexpr (ComponentName<T>::value != nullptr)
+		{
+			return ComponentName<T>::value;
+		}
+		else if constexpr (Serializer<T>::enabled)
+		{
+			return Serializer<T>::name;
+		}
+		else
 		{
-			entityList.clear();
-			aabbList.clear();
-			NE.reset();
-			NW.reset();
-			SW.reset();
-			SE.reset();
+			return "component#" + std::to_string(ComponentTypeId<T>());
 		}
+	}
+
+	struct PoolStats
+	{
+		std::string name;
+		size_t size = 0;
+		size_t bytes = 0;//ϼ
+		size_t copies = 0;//һνʱͬ
 	};
 
 	class DoubleBufferedBase
 	{
 	public:
 		virtual void swap() {}
+		virtual PoolStats stats() const
+		{
+			return PoolStats();
+		}
+		//бʶóصļлʱΪ0Worldʱ
+		virtual uint64_t serialKey() const
+		{
+			return 0;
+		}
+		virtual void save(BinaryWriter&) const {}
+		//նȡstageLoadֻ뵽ݴնȡɹcommitLoad滻壬ʧdiscardLoad
+		virtual bool stageLoad(BinaryReader&)
+		{
+			return true;
+		}
+		virtual void commitLoad() {}
+		virtual void discardLoad() {}
 		DoubleBufferedBase() = default;
 		virtual ~DoubleBufferedBase() = default;
 	};
@@ -572,10 +2505,104 @@ namespace ecs
 		{
 			return state ? data1 : data0;
 		}
-		void swap()
+		void swap() override
+		{
+			state = !state;
+		}
+	};
+
+	//ص˫壺ϵͳactivemodifyдinactiveǰֻѱǵͬһ
+	//ÿ֡ʼʱһ£δ޸ĵκθ
+	template<typename T>
+	class DoubleBuffered<ComponentPool<T>*> : public DoubleBufferedBase
+	{
+	private:
+		ComponentPool<T>* data0;
+		ComponentPool<T>* data1;
+		bool state;
+		size_t lastCopies = 0;
+		std::optional<typename ComponentPool<T>::Loaded> staged;
+	public:
+		DoubleBuffered(ComponentPool<T>* buffer0, ComponentPool<T>* buffer1, bool state) : data0(buffer0), data1(buffer1), state(state) {}
+		ComponentPool<T>* const& active() const
+		{
+			return state ? data0 : data1;
+		}
+		ComponentPool<T>*& active()
+		{
+			return state ? data0 : data1;
+		}
+		ComponentPool<T>* const& inactive() const
+		{
+			return state ? data1 : data0;
+		}
+		ComponentPool<T>*& inactive()
+		{
+			return state ? data1 : data0;
+		}
+		void swap() override
 		{
+			lastCopies = inactive()->syncDirtyTo(*active()) + active()->syncDirtyTo(*inactive());
 			state = !state;
 		}
+		PoolStats stats() const override
+		{
+			PoolStats result;
+			result.name = ComponentNameOf<T>();
+			result.size = active()->size();
+			result.bytes = data0->memoryUsage() + data1->memoryUsage();
+			result.copies = lastCopies;
+			return result;
+		}
+		uint64_t serialKey() const override
+		{
+			if constexpr (Serializer<T>::enabled)
+			{
+				return strHash(Serializer<T>::name);
+			}
+			else
+			{
+				return 0;
+			}
+		}
+		//֮֡һ£ֻдactiveȡʱָΪͬһ
+		void save(BinaryWriter& out) const override
+		{
+			if constexpr (Serializer<T>::enabled)
+			{
+				active()->save(out);
+			}
+		}
+		bool stageLoad(BinaryReader& in) override
+		{
+			if constexpr (Serializer<T>::enabled)
+			{
+				staged.emplace();
+				if (!ComponentPool<T>::read(in, *staged))
+				{
+					staged.reset();
+					return false;
+				}
+			}
+			return true;
+		}
+		void commitLoad() override
+		{
+			if constexpr (Serializer<T>::enabled)
+			{
+				if (staged.has_value())
+				{
+					lastCopies = 0;
+					inactive()->assign(*staged);
+					active()->assign(std::move(*staged));
+					staged.reset();
+				}
+			}
+		}
+		void discardLoad() override
+		{
+			staged.reset();
+		}
 	};
 
 	//using T = int;
@@ -120,6 +120,11 @@ namespace galgame
 	public:
 		StandardTextBoxSystem(ecs::DoubleComs<StandardTextBox>* textBoxs, ecs::Layers* layers, int layerDepth) : textBoxs(textBoxs), layers(layers), layerDepth(layerDepth) {}
 
+		const char* name() const override
+		{
+			return "galgame::StandardTextBoxSystem";
+		}
+
 		void update() override
 		{
 			textBoxs->active()->forEach
@@ -27,46 +27,26 @@ class MenuWorld : public ecs::World2D
 private:
 	rlRAII::MusicRAII music;
 	AllStates& state;
-	int buttonStart;
-	int buttonConfig;
-	int background;
-	int buttonExId;
-	int animationId;
+	ecs::entity buttonStart;
+	ecs::entity buttonConfig;
+	ecs::entity background;
+	ecs::entity buttonExId;
+	ecs::entity animationId;
 	float& volume;
 
 	class System : public ecs::SystemBase
 	{
 	private:
-		AllStates& state;
 		float& volume;
-		int start;
-		int config;
-		ecs::MessageManager& msgMgr;
 		rlRAII::MusicRAII music;
 
 	public:
-		System(ecs::MessageManager* msgMgr, AllStates& state, int start, int config, rlRAII::MusicRAII& music, float& volume) : msgMgr(*msgMgr), state(state), start(start), config(config), music(music), volume(volume) {}
+		System(rlRAII::MusicRAII& music, float& volume) : music(music), volume(volume) {}
 
 		void update()
 		{
 			SetMusicVolume(music.get(), volume);
 			UpdateMusicStream(music.get());
-			auto s = msgMgr.getMessageList(start);
-			auto c = msgMgr.getMessageList(config);
-			if (s != nullptr)
-			{
-				if (s->size() > 0)
-				{
-					state = AllStates::Main;
-				}
-			}
-			if (c != nullptr)
-			{
-				if (c->size() > 0)
-				{
-					state = AllStates::Config;
-				}
-			}
 		}
 	};
 
@@ -104,7 +84,11 @@ public:
 		this->getSystem<ui::ButtonSystem>()->registerListener(buttonStart, buttonStart);
 		this->getSystem<ui::ButtonSystem>()->registerListener(buttonConfig, buttonConfig);
 
-		this->addSystem(System(this->getMessageManager(), state, buttonStart, buttonConfig, music, volume));
+		//ťϢsendAllʱֱӴÿ֡ѯϢб
+		this->getMessageManager()->addHandler<ui::ButtonPressMsg>(buttonStart, [this](const ui::ButtonPressMsg&) { this->state = AllStates::Main; });
+		this->getMessageManager()->addHandler<ui::ButtonPressMsg>(buttonConfig, [this](const ui::ButtonPressMsg&) { this->state = AllStates::Config; });
+
+		this->addSystem(System(music, volume));
 	}
 
 
@@ -116,11 +100,11 @@ private:
 	AllStates& state;
 	bool& showFPS;
 
-	int back;
-	int select;
-	int text;
-	int musicDynamicSlider;
-	int mscVlm;
+	ecs::entity back;
+	ecs::entity select;
+	ecs::entity text;
+	ecs::entity musicDynamicSlider;
+	ecs::entity mscVlm;
 
 	rlRAII::Texture2DRAII bg;
 	bool initialized = false;
@@ -130,33 +114,19 @@ private:
 	class System : public ecs::SystemBase
 	{
 	private:
-		AllStates& state;
-		int back;
-		int select;
-		int slider;
-		ecs::MessageManager& msgMgr;
+		ecs::entity select;
+		ecs::entity slider;
 		bool& showFPS;
-		float& timeCount;
 		float& volume;
 		ecs::World2D* wld;
 
 	public:
-		System(ecs::MessageManager* msgMgr, AllStates& state, int back, int select, int slider, bool& showFPS, float& volume, ecs::World2D* wld, bool& init, float& timeCount) : msgMgr(*msgMgr), state(state), back(back), select(select), wld(wld), showFPS(showFPS), timeCount(timeCount), slider(slider), volume(volume) {}
+		System(ecs::entity select, ecs::entity slider, bool& showFPS, float& volume, ecs::World2D* wld) : select(select), wld(wld), showFPS(showFPS), slider(slider), volume(volume) {}
 
 		void update()
 		{
-			auto b = msgMgr.getMessageList(back);
 			auto s = wld->getDoubleBuffer<ui::SwitchCom>()->active()->get(select);
 			volume = wld->getDoubleBuffer<ui::SliderCom>()->active()->get(slider)->value * 2.0f;
-			if (b != nullptr)
-			{
-				if (b->size() > 0)
-				{
-					state = AllStates::Menu;
-					//init = false;
-					timeCount = 0.0f;
-				}
-			}
 			if (s != nullptr)
 			{
 				if (s->state)
@@ -236,7 +206,13 @@ public:
 		this->getSystem<ui::ButtonSystem>()->registerListener(back, back);
 		this->getSystem<ui::ButtonSystem>()->registerListener(select, select);
 
-		this->addSystem(System(this->getMessageManager(), state, back, select, musicDynamicSlider, showFPS, volume, this, initialized, timeCount));
+		this->getMessageManager()->addHandler<ui::ButtonPressMsg>(back, [this](const ui::ButtonPressMsg&)
+			{
+				this->state = AllStates::Menu;
+				timeCount = 0.0f;
+			});
+
+		this->addSystem(System(select, musicDynamicSlider, showFPS, volume, this));
 		this->addSystem(Sys(this->getUiLayer(), bg));
 	}
 
@@ -276,7 +252,7 @@ private:
 	std::string text1;
 	std::string font;
 
-	int textId;
+	ecs::entity textId;
 
 public:
 	MainScene(ecs::World2D* world, gotoNode<SceneBase> selfNode, gotoNode<SceneBase> nextNode, std::string text0, std::string text1, std::string font) : world(world),selfNode(selfNode), nextNode(nextNode), isInitialized(false), text0(text0), text1(text1), font(font) {}
@@ -328,8 +304,14 @@ private:
 
 	bool isInitialized;
 
-	int b0Id;
-	int b1Id;
+	ecs::entity b0Id;
+	ecs::entity b1Id;
+	ecs::MessageHandlerId b0Handler = 0;
+	ecs::MessageHandlerId b1Handler = 0;
+	int chosen = -1;//ɰťϢĴ
+
+	ecs::PrefabId b0Prefab = ecs::NULL_PREFAB;//״νʱ죬֮볡ֻʵ
+	ecs::PrefabId b1Prefab = ecs::NULL_PREFAB;
 
 public:
 	SelectScene(ecs::World2D* world, gotoNode<SceneBase> selfNode, gotoNode<SceneBase> nextNode0, gotoNode<SceneBase> nextNode1, std::string font)
@@ -339,69 +321,67 @@ public:
 	{
 		if (isInitialized)
 		{
-			auto b0 = world->getMessageManager()->getMessageList(b0Id);
-			if (b0 != nullptr)
+			if (chosen < 0)
 			{
-				if (b0->size() > 0)
-				{
-					world->deleteUnit(b0Id);
-					world->deleteUnit(b1Id);
-					world->getEntityManager()->recycleId(b0Id);
-					world->getEntityManager()->recycleId(b1Id);
-					isInitialized = false;
-					return nextNode0;
-				}
-			}
-			auto b1 = world->getMessageManager()->getMessageList(b1Id);
-			if (b1 != nullptr)
-			{
-				if (b1->size() > 0)
-				{
-					world->deleteUnit(b0Id);
-					world->deleteUnit(b1Id);
-					world->getEntityManager()->recycleId(b0Id);
-					world->getEntityManager()->recycleId(b1Id);
-					isInitialized = false;
-					return nextNode1;
-				}
+				return selfNode;
 			}
-			return selfNode;
+			world->deleteUnit(b0Id);
+			world->deleteUnit(b1Id);
+			world->getSystem<ui::ButtonSystem>()->unregisterButton(b0Id);
+			world->getSystem<ui::ButtonSystem>()->unregisterButton(b1Id);
+			world->getEntityManager()->recycleId(b0Id);
+			world->getEntityManager()->recycleId(b1Id);
+			world->getMessageManager()->removeHandler(b0Handler);
+			world->getMessageManager()->removeHandler(b1Handler);
+			isInitialized = false;
+			return chosen == 0 ? nextNode0 : nextNode1;
 		}
 		else
 		{
+			Stopwatch watch;
+			if (!world->hasPrefab(b0Prefab))
+			{
+				b0Prefab = world->registerPrefab(ui::ButtonExCom
+				(
+					FONT_PATH,
+					"resource\\img\\ť0.png",
+					"resource\\img\\ť1.png",
+					"resource\\img\\ť2.png",
+					u8"ѩ",
+					WHITE,
+					50,
+					5,
+					{ 810,320 },
+					{ 300,80 },
+					8
+				));
+				b1Prefab = world->registerPrefab(ui::ButtonExCom
+				(
+					FONT_PATH,
+					"resource\\img\\ť0.png",
+					"resource\\img\\ť1.png",
+					"resource\\img\\ť2.png",
+					u8"ܽ",
+					WHITE,
+					50,
+					5,
+					{ 810,680 },
+					{ 300,80 },
+					8
+				));
+				TraceLog(LOG_INFO, "SelectScene: construct buttons %.3f ms", watch.milliseconds());
+				watch.restart();
+			}
 			b0Id = world->getEntityManager()->getId();
 			b1Id = world->getEntityManager()->getId();
-			world->createUnit(b0Id, ui::ButtonExCom
-			(
-				FONT_PATH,
-				"resource\\img\\ť0.png",
-				"resource\\img\\ť1.png",
-				"resource\\img\\ť2.png",
-				u8"ѩ",
-				WHITE,
-				50,
-				5,
-				{ 810,320 },
-				{ 300,80 },
-				8
-			));
-			world->createUnit(b1Id, ui::ButtonExCom
-			(
-				FONT_PATH,
-				"resource\\img\\ť0.png",
-				"resource\\img\\ť1.png",
-				"resource\\img\\ť2.png",
-				u8"ܽ",
-				WHITE,
-				50,
-				5,
-				{ 810,680 },
-				{ 300,80 },
-				8
-			));
+			world->instantiate(b0Prefab, b0Id).instantiate(b1Prefab, b1Id);
+			TraceLog(LOG_INFO, "SelectScene: instantiate buttons %.3f ms", watch.milliseconds());
 			//world->createUnit(b1Id, ui::ButtonExCom({ 810, 680 }, 300, 80, 50, WHITE, BLUE, u8"ܽ", font));
 			world->getSystem<ui::ButtonSystem>()->registerListener(b0Id, b0Id);
 			world->getSystem<ui::ButtonSystem>()->registerListener(b1Id, b1Id);
+			chosen = -1;
+			b0Handler = world->getMessageManager()->addHandler<ui::ButtonPressMsg>(b0Id, [this](const ui::ButtonPressMsg&) { chosen = 0; });
+			b1Handler = world->getMessageManager()->addHandler<ui::ButtonPressMsg>(b1Id, [this](const ui::ButtonPressMsg&) { chosen = chosen < 0 ? 1 : chosen; });
 			isInitialized = true;
 			return selfNode;
 		}
@@ -419,7 +399,7 @@ private:
 	std::string text1;
 	std::string font;
 
-	int textId;
+	ecs::entity textId;
 
 	float timeCount = 0.0f;
 
@@ -593,6 +573,11 @@ int main()
 	Config config(state, showFPS, volume, WinWidth, WinHeight);
 	Main main(FONT_PATH, WinWidth, WinHeight, volume);
 
+	ThreadPool threadPool;
+	menu.setThreadPool(&threadPool);
+	config.setThreadPool(&threadPool);
+	main.setThreadPool(&threadPool);
+
 	//rlRAII::FileRAII fd = FONT_PATH;
 	//rlRAII::FontRAII f = DynamicLoadFontFromMemory((std::string(u8"һηǳ֮ģڲԶеģŵģûκʵģҴģϻƪĲı") + std::string(u8"ǳLһΤǡԄӸФΥƥȤʹäǤ롢ζյĤζΤʤo˴򤿤줿LʥƥȥƥȤǤ")).c_str(), fd.fileName(), fd.get(), fd.size(), 50);
 	
@@ -24,95 +24,130 @@ namespace ecs
 		MessageTypeId getType() const { return type; }
 	};
 
-	void MessageUnicast(MessageBase* msg, entity target, ComponentPool<std::vector<MessageBase*>>& msgList)
+	//߱֡յϢ鲥дdirect㲥ǹж߹һб
+	//ȡʱߺϲΪһУ㲥ں棬һ㲥Ŀ붩޹
+	class MessageInbox
 	{
-		auto list = msgList.get(target);
-		if (list != nullptr)
+	private:
+		std::vector<MessageBase*> direct;
+		const std::vector<MessageBase*>* broadcasts = nullptr;
+
+		friend class MessageManager;
+
+	public:
+		class iterator
+		{
+		private:
+			const MessageInbox* inbox;
+			size_t index;
+
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = MessageBase*;
+			using difference_type = std::ptrdiff_t;
+			using pointer = MessageBase* const*;
+			using reference = MessageBase*;
+
+			iterator(const MessageInbox* inbox, size_t index) : inbox(inbox), index(index) {}
+			MessageBase* operator*() const { return (*inbox)[index]; }
+			iterator& operator++() { ++index; return *this; }
+			iterator operator++(int) { iterator result = *this; ++index; return result; }
+			bool operator==(const iterator& other) const { return index == other.index; }
+			bool operator!=(const iterator& other) const { return index != other.index; }
+		};
+
+		MessageInbox() = default;
+		explicit MessageInbox(const std::vector<MessageBase*>* broadcasts) : broadcasts(broadcasts) {}
+
+		size_t size() const
 		{
-			list->push_back(msg);
+			return direct.size() + (broadcasts == nullptr ? 0 : broadcasts->size());
 		}
-		else
+		bool empty() const
 		{
-			msgList.add(target, std::vector<MessageBase*>());
-			msgList.get(target)->push_back(msg);
+			return size() == 0;
 		}
-	}
-	void MessageMulticast(MessageBase* msg, const std::vector<entity>& target, ComponentPool<std::vector<MessageBase*>>& msgList)
-	{
-		for (auto t : target)
+		MessageBase* operator[](const size_t i) const
 		{
-			auto list = msgList.get(t);
-			if (list != nullptr)
-			{
-				list->push_back(msg);
-			}
-			else
-			{
-				msgList.add(t, std::vector<MessageBase*>());
-				msgList.get(t)->push_back(msg);
-			}
+			return i < direct.size() ? direct[i] : (*broadcasts)[i - direct.size()];
+		}
+		iterator begin() const { return iterator(this, 0); }
+		iterator end() const { return iterator(this, size()); }
+
+		const std::vector<MessageBase*>& directMessages() const//ֻ鲥
+		{
+			return direct;
 		}
+	};
+
+	//ϢڽڵĳܱţMessageTypeManagerԴΪ±ңRTTI
+	inline size_t NextMessageTypeKey()
+	{
+		static std::atomic<size_t> counter{ 0 };
+		return counter.fetch_add(1, std::memory_order_relaxed);
 	}
-	void MessageBroadcast(MessageBase* msg, ComponentPool<std::vector<MessageBase*>>& msgList)
+	template<typename T>
+	inline size_t MessageTypeKey()
 	{
-		msgList.forEach
-		(
-			[msg](entity id, std::vector<MessageBase*>& list)
-			{
-				list.push_back(msg);
-			}
-		);
+		static const size_t key = NextMessageTypeKey();
+		return key;
 	}
 
 	class MessageTypeManager
 	{
 	private:
+		static constexpr MessageTypeId NOT_REGISTERED = SIZE_MAX;
+
 		IdManager idManager;
-		std::unordered_map<std::type_index, MessageTypeId> typeToId;
-		std::vector<std::type_index> idToType;
+		std::vector<MessageTypeId> keyToId;//MessageTypeKeyΪ±
+		std::vector<size_t> idToKey;
 
 	public:
 		template<typename T>
 		//using T = int;
 		MessageTypeId registeredType()
 		{
-			auto it = typeToId.find(std::type_index(typeid(T)));
-			if (it != typeToId.end())
+			const size_t key = MessageTypeKey<T>();
+			if (key < keyToId.size() && keyToId[key] != NOT_REGISTERED)
 			{
-				return it->second;//ظע
+				return keyToId[key];//ظע
 			}
 			else
 			{
 				MessageTypeId id = idManager.getId();
-				typeToId.emplace(std::type_index(typeid(T)), id);
+				if (key >= keyToId.size())
+				{
+					keyToId.resize(key + 10, NOT_REGISTERED);//Ԥ
+				}
+				keyToId[key] = id;
 
-				if (id >= idToType.size())
+				if (id >= idToKey.size())
 				{
-					idToType.resize(id + 10, std::type_index(typeid(void)));//Ԥ
+					idToKey.resize(id + 10, SIZE_MAX);//Ԥ
 				}
-				idToType[id] = std::type_index(typeid(T));
+				idToKey[id] = key;
 
 				return id;
 			}
 		}
-		std::type_index getType(MessageTypeId id)
+		size_t getType(MessageTypeId id)//ñŶӦ͵MessageTypeKeyδעʱΪSIZE_MAX
 		{
-			if (id < idToType.size())
+			if (id < idToKey.size())
 			{
-				return idToType[id];
+				return idToKey[id];
 			}
 			else
 			{
-				return std::type_index(typeid(void));
+				return SIZE_MAX;
 			}
 		}
 		template<typename T>
 		MessageTypeId getId()
 		{
-			auto it = typeToId.find(std::type_index(typeid(T)));
-			if (it != typeToId.end())
+			const size_t key = MessageTypeKey<T>();
+			if (key < keyToId.size())
 			{
-				return it->second;
+				return keyToId[key];
 			}
 			else
 			{
@@ -121,164 +156,956 @@ namespace ecs
 		}
 	};
 
-	class MessageManager
+	//ʵɾϢָ룺MessageBaseûָͨdelete
+	using OwnedMessage = std::unique_ptr<MessageBase, void(*)(MessageBase*)>;
+	template<typename T>
+	OwnedMessage OwnMessage(std::unique_ptr<T>&& msg)
+	{
+		return OwnedMessage(msg.release(), [](MessageBase* p) { delete static_cast<T*>(p); });
+	}
+
+	//дյϢͣSerializer<T>::nameĹϣʶȡʱеͱؽ
+	struct MessageCodec
+	{
+		uint64_t key = 0;
+		void (*write)(BinaryWriter&, const MessageBase&) = nullptr;
+		OwnedMessage(*read)(BinaryReader&, entity, MessageTypeManager&) = nullptr;
+	};
+	//ûиݵϢ
+	//template<> struct ecs::Serializer<Msg> : ecs::EmptyMessageSerializer<Msg> { static constexpr const char* name = "Msg"; };
+	template<typename T>
+	struct EmptyMessageSerializer
+	{
+		static constexpr bool enabled = true;
+		static void write(BinaryWriter& out, const T& msg) {}
+		static std::unique_ptr<T> read(BinaryReader& in, entity sender, MessageTypeId type)
+		{
+			return std::make_unique<T>(sender, type);
+		}
+	};
+
+	//һϢڴ棺˳䣬resetӵһʹã鱾ͷ
+	//ƽϢresetʱκ£ϢǼresetʱ
+	class MessageArena
 	{
 	private:
-		std::vector<std::unique_ptr<MessageBase>> msgUnicastList0;
-		std::vector<std::unique_ptr<MessageBase>> msgUnicastList1;
-		std::vector<entity> unicastTargetList0;
-		std::vector<entity> unicastTargetList1;
+		static constexpr size_t BLOCK_SIZE = 64 * 1024;
 
-		std::vector<std::unique_ptr<MessageBase>> msgMulticastList0;
-		std::vector<std::unique_ptr<MessageBase>> msgMulticastList1;
-		std::vector<std::vector<entity>> multicastTargetList0;
-		std::vector<std::vector<entity>> multicastTargetList1;
+		struct Block
+		{
+			std::unique_ptr<unsigned char[]> data;
+			size_t size;
+		};
+		struct Destructor
+		{
+			void* object;
+			void (*destroy)(void*);
+		};
 
-		std::vector<std::unique_ptr<MessageBase>> msgBroadcastList0;
-		std::vector<std::unique_ptr<MessageBase>> msgBroadcastList1;
+		std::vector<Block> blocks;
+		size_t current = 0;
+		size_t offset = 0;
+		std::vector<Destructor> destructors;
 
-		bool active;
+		void* allocate(const size_t size, const size_t alignment)
+		{
+			while (current < blocks.size())
+			{
+				const uintptr_t base = reinterpret_cast<uintptr_t>(blocks[current].data.get());
+				const size_t aligned = size_t((base + offset + alignment - 1) / alignment * alignment - base);
+				if (aligned + size <= blocks[current].size)
+				{
+					offset = aligned + size;
+					return blocks[current].data.get() + aligned;
+				}
+				++current;
+				offset = 0;
+			}
+			const size_t blockSize = std::max(BLOCK_SIZE, size + alignment);
+			blocks.push_back(Block{ std::make_unique<unsigned char[]>(blockSize), blockSize });
+			return allocate(size, alignment);
+		}
 
-		std::mutex mutex;
+	public:
+		MessageArena() = default;
+		MessageArena(const MessageArena&) = delete;
+		MessageArena& operator=(const MessageArena&) = delete;
+		~MessageArena()
+		{
+			reset();
+		}
 
-		MessageTypeManager messageTypeManager;
+		template<typename T, typename ...Args>
+		T* create(Args&&...args)
+		{
+			T* obj = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+			if constexpr (!std::is_trivially_destructible_v<T>)
+			{
+				destructors.push_back(Destructor{ obj, [](void* p) { static_cast<T*>(p)->~T(); } });
+			}
+			return obj;
+		}
+		void reset()
+		{
+			for (auto it = destructors.rbegin(); it != destructors.rend(); ++it)
+			{
+				it->destroy(it->object);
+			}
+			destructors.clear();
+			current = 0;
+			offset = 0;
+		}
+		size_t capacity() const//Ŀֽ
+		{
+			size_t result = 0;
+			for (auto& block : blocks)
+			{
+				result += block.size;
+			}
+			return result;
+		}
+	};
 
-		std::vector<std::unique_ptr<MessageBase>>& unicastActive() { return active ? msgUnicastList0 : msgUnicastList1; }
-		std::vector<std::unique_ptr<MessageBase>>& unicastInactive() { return active ? msgUnicastList1 : msgUnicastList0; }
+	//һʵidڴ棻std::vectorʽ
+	struct EntitySpan
+	{
+		const entity* data = nullptr;
+		size_t size = 0;
 
-		std::vector<std::unique_ptr<MessageBase>>& multicastActive() { return active ? msgMulticastList0 : msgMulticastList1; }
-		std::vector<std::unique_ptr<MessageBase>>& multicastInactive() { return active ? msgMulticastList1 : msgMulticastList0; }
+		EntitySpan() = default;
+		EntitySpan(const entity* data, size_t size) : data(data), size(size) {}
+		EntitySpan(const std::vector<entity>& ids) : data(ids.data()), size(ids.size()) {}
+		const entity* begin() const { return data; }
+		const entity* end() const { return data + size; }
+	};
 
-		std::vector<std::unique_ptr<MessageBase>>& broadcastActive() { return active ? msgBroadcastList0 : msgBroadcastList1; }
-		std::vector<std::unique_ptr<MessageBase>>& broadcastInactive() { return active ? msgBroadcastList1 : msgBroadcastList0; }
+	//ԤȵǼǵ鲥Ŀ꼯ϣͬһʱÿδ벢Ŀб
+	//鲥Ŀıţʽ죬entityᱻѡ
+	struct TargetGroupId
+	{
+		uint32_t value = UINT32_MAX;
 
-		std::vector<entity>& unicastTargetListActive() { return active ? unicastTargetList0 : unicastTargetList1; }
-		std::vector<entity>& unicastTargetListInactive() { return active ? unicastTargetList1 : unicastTargetList0; }
+		TargetGroupId() = default;
+		explicit constexpr TargetGroupId(const uint32_t value) : value(value) {}
+		constexpr bool operator==(const TargetGroupId other) const { return value == other.value; }
+		constexpr bool operator!=(const TargetGroupId other) const { return value != other.value; }
+	};
+	constexpr TargetGroupId NULL_TARGET_GROUP = TargetGroupId(UINT32_MAX);
+
+	//һеȴ͵ϢϢarenaУɽӿڴunique_ptrowned
+	//鲥Ŀ갴CSRţiĿΪmulticastTargets[multicastBegin(i), multicastEnds[i])
+	//multicastGroups[i]ΪNULL_TARGET_GROUPʱΪգĿΪsendAllʱĳԱ
+	struct MessageQueue
+	{
+		std::vector<MessageBase*> unicast;
+		std::vector<entity> unicastTargets;
+		std::vector<MessageBase*> multicast;
+		std::vector<uint32_t> multicastEnds;
+		std::vector<entity> multicastTargets;
+		std::vector<TargetGroupId> multicastGroups;
+		std::vector<MessageBase*> broadcast;
 
-		std::vector<std::vector<entity>>& multicastTargetListActive() { return active ? multicastTargetList0 : multicastTargetList1; }
-		std::vector<std::vector<entity>>& multicastTargetListInactive() { return active ? multicastTargetList1 : multicastTargetList0; }
+		MessageArena arena;
+		std::vector<OwnedMessage> owned;
 
-		ComponentPool<std::vector<MessageBase*>> messageList;
+		MessageBase* adopt(OwnedMessage&& msg)
+		{
+			owned.push_back(std::move(msg));
+			return owned.back().get();
+		}
+		void pushMulticast(MessageBase* msg, const EntitySpan targets)
+		{
+			multicast.push_back(msg);
+			multicastTargets.insert(multicastTargets.end(), targets.begin(), targets.end());
+			multicastEnds.push_back(uint32_t(multicastTargets.size()));
+			multicastGroups.push_back(NULL_TARGET_GROUP);
+		}
+		void pushMulticast(MessageBase* msg, const TargetGroupId group)
+		{
+			multicast.push_back(msg);
+			multicastEnds.push_back(uint32_t(multicastTargets.size()));
+			multicastGroups.push_back(group);
+		}
+		size_t multicastBegin(const size_t i) const
+		{
+			return i == 0 ? 0 : multicastEnds[i - 1];
+		}
+		void clear()
+		{
+			unicast.clear();
+			unicastTargets.clear();
+			multicast.clear();
+			multicastEnds.clear();
+			multicastTargets.clear();
+			multicastGroups.clear();
+			broadcast.clear();
+			arena.reset();
+			owned.clear();
+		}
+		//նȡϢЩϢownedУloadedarena
+		void replaceWith(MessageQueue& loaded)
+		{
+			clear();
+			unicast.swap(loaded.unicast);
+			unicastTargets.swap(loaded.unicastTargets);
+			multicast.swap(loaded.multicast);
+			multicastEnds.swap(loaded.multicastEnds);
+			multicastTargets.swap(loaded.multicastTargets);
+			multicastGroups.swap(loaded.multicastGroups);
+			broadcast.swap(loaded.broadcast);
+			owned.swap(loaded.owned);
+		}
+	};
 
+	//ϢsendAllַϢʱֱӵãÿ֡ѯgetMessageList
+	class MessageHandlerBase
+	{
+	public:
+		virtual ~MessageHandlerBase() = default;
+		virtual void handle(const MessageBase& msg) = 0;
+	};
+	template<typename T, typename Func>
+	class MessageHandler : public MessageHandlerBase
+	{
+	private:
+		Func func;
 
 	public:
-		MessageManager& addUnicastMessage(std::unique_ptr<MessageBase>&& msg, entity targetId)
+		explicit MessageHandler(Func func) : func(std::move(func)) {}
+		void handle(const MessageBase& msg) override
 		{
-			std::lock_guard lock(mutex);
-			auto& l = unicastInactive();
-			l.push_back(std::move(msg));
-			unicastTargetListInactive().push_back(targetId);
-			return *this;
+			func(static_cast<const T&>(msg));
 		}
-		MessageManager& addMulticastMessage(std::unique_ptr<MessageBase>&& msg, const std::vector<entity>& targetIds)
+	};
+	using MessageHandlerId = uint64_t;
+
+	//ǰ̵߳߱ţϢĸݴNO_MESSAGE_PRODUCERʾδָ
+	//߳޹أɵ߸Worldϵͳʱʹϵͳбе±꣬˺ϲ˳ڶмһ
+	constexpr size_t NO_MESSAGE_PRODUCER = SIZE_MAX;
+	inline size_t& CurrentMessageProducer()
+	{
+		thread_local size_t producer = NO_MESSAGE_PRODUCER;
+		return producer;
+	}
+	//ڰѵǰ̵߳߱ΪidʱָǶ
+	//ͬһʱֻһ߳ʹͬһ
+	class MessageProducerScope
+	{
+	private:
+		size_t previous;
+
+	public:
+		explicit MessageProducerScope(const size_t id) : previous(CurrentMessageProducer())
 		{
-			std::lock_guard lock(mutex);
-			auto& l = multicastInactive();
-			l.push_back(std::move(msg));
-			multicastTargetListInactive().push_back(targetIds);
-			return *this;
+			CurrentMessageProducer() = id;
 		}
-		MessageManager& addBroadcastMessage(std::unique_ptr<MessageBase>&& msg)
+		~MessageProducerScope()
 		{
-			std::lock_guard lock(mutex);
-			auto& l = broadcastInactive();
-			l.push_back(std::move(msg));
-			return *this;
+			CurrentMessageProducer() = previous;
 		}
+		MessageProducerScope(const MessageProducerScope&) = delete;
+		MessageProducerScope& operator=(const MessageProducerScope&) = delete;
+	};
+
+	//һߵݴĻԾӦֻгиñŵ߳д
+	struct MessageLane
+	{
+		MessageQueue queues[2];
+	};
+
+	//add*Message̲߳ã߱СMAX_PRODUCERS߳дñŵݴ
+	//δָŻŹ߳д빲壬sendAll/swap/save/loadû̷߳ϢʱãWorld֮֡ã
+	//ַ˳򣺵鲥ڹ㲥ͬϢȹ壬ٰ߱ŴСͬһڱַ˳
+	//֮ͬȺֻɱž̺߳ʵʷʱ޹أв̵ͬ߳Ⱥȡڼ˳򣬲ɸ
+	class MessageManager
+	{
+	public:
+		static constexpr size_t MAX_PRODUCERS = 64;
+
+	private:
+		MessageQueue shared[2];
+		std::array<std::atomic<MessageLane*>, MAX_PRODUCERS> lanes{};
+		std::vector<std::unique_ptr<MessageLane>> laneStorage;
+		std::atomic<size_t> laneLimit{ 0 };//Ѵݴ+1
+
+		bool active = true;
+
+		mutable std::mutex mutex;
+
+		MessageTypeManager messageTypeManager;
 
-		std::vector<MessageBase*>* getMessageList(entity id)
+		size_t activeIndex() const { return active ? 0 : 1; }
+		size_t inactiveIndex() const { return active ? 1 : 0; }
+
+		MessageLane* createLane(const size_t slot)
 		{
 			std::lock_guard lock(mutex);
-			return messageList.get(id);
+			MessageLane* lane = lanes[slot].load(std::memory_order_acquire);
+			if (lane == nullptr)
+			{
+				laneStorage.push_back(std::make_unique<MessageLane>());
+				lane = laneStorage.back().get();
+				lanes[slot].store(lane, std::memory_order_release);
+				if (slot >= laneLimit.load(std::memory_order_relaxed))
+				{
+					laneLimit.store(slot + 1, std::memory_order_release);
+				}
+			}
+			return lane;
+		}
+		//ȡõǰ߳дķǻԾ岢ִfunc
+		template<typename Func>
+		void stage(Func&& func)
+		{
+			const size_t slot = CurrentMessageProducer();
+			if (slot < MAX_PRODUCERS)
+			{
+				MessageLane* lane = lanes[slot].load(std::memory_order_acquire);
+				if (lane == nullptr)
+				{
+					lane = createLane(slot);
+				}
+				func(lane->queues[inactiveIndex()]);
+			}
+			else
+			{
+				std::lock_guard lock(mutex);
+				func(shared[inactiveIndex()]);
+			}
+		}
+		//ַ˳ĳһȫ壺ȹ壬ٰ߱
+		template<typename Func>
+		void forEachQueue(const size_t index, Func&& func)
+		{
+			func(shared[index]);
+			const size_t limit = laneLimit.load(std::memory_order_acquire);
+			for (size_t slot = 0; slot < limit; ++slot)
+			{
+				if (MessageLane* lane = lanes[slot].load(std::memory_order_acquire))
+				{
+					func(lane->queues[index]);
+				}
+			}
 		}
 
-		MessageTypeManager& getMessageTypeManager() { return messageTypeManager; };
+		ComponentPool<MessageInbox> messageList;
+		std::vector<MessageBase*> broadcastFrame;//֡ѷ͵Ĺ㲥жߵMessageInboxָ
+		bool directSent = false;//֡Ƿַ鲥ûʱswapر
 
-		void subscribe(entity id)//ϢκδϢʵ岻յκϢĺ󽫽չ㲥ϢΪĿʱ鲥/Ϣ
+		struct HandlerKey
 		{
-			//std::lock_guard lock(mutex);
-			messageList.add(id, std::vector<MessageBase*>());
+			MessageTypeId type;
+			entity target;
+			bool operator==(const HandlerKey& other) const { return type == other.type && target == other.target; }
+		};
+		struct HandlerKeyHash
+		{
+			size_t operator()(const HandlerKey& key) const
+			{
+				return std::hash<uint64_t>()(key.type * 0x9E3779B97F4A7C15ull ^ key.target);
+			}
+		};
+		struct HandlerEntry
+		{
+			MessageHandlerId id;
+			std::unique_ptr<MessageHandlerBase> handler;
+		};
+		std::unordered_map<HandlerKey, std::vector<HandlerEntry>, HandlerKeyHash> handlers;
+		std::unordered_map<MessageHandlerId, HandlerKey> handlerKeys;
+		std::unordered_map<MessageTypeId, std::vector<entity>> handledTargets;//ÿдĿ꣬㲥ʱ
+		MessageHandlerId nextHandlerId = 1;
+		bool dispatching = false;
+		std::vector<Task> pendingHandlerChanges;//ַڼɾַύ˳Ӧ
+
+		std::vector<uint64_t> dispatchCounts;//ͱۼƵĴôڷַʱۼ
+		std::vector<uint64_t> frameDispatchCounts;//sendAllĵôֻɷ̷ַ߳
+		std::vector<MessageTypeId> dispatchedTypes;
+		std::function<void(MessageTypeId, uint64_t)> dispatchHook;
+
+		//鲥ʹcountĿꣻĿδʱԶģԭΪһ£
+		void deliver(MessageBase* msg, const entity* targets, const size_t count)
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				MessageInbox* inbox = messageList.get(targets[i]);
+				if (inbox == nullptr)
+				{
+					messageList.add(targets[i], MessageInbox(&broadcastFrame));
+					inbox = messageList.get(targets[i]);
+				}
+				inbox->direct.push_back(msg);
+			}
 		}
-		void unsubscribe(entity id)//ȡģյκϢ
+
+		std::vector<std::vector<entity>> targetGroups;//TargetGroupIdٵΪ
+		//ٵʱswapȺУswap鲻ٱκδ鲥ãԸ
+		std::vector<std::pair<uint32_t, uint64_t>> retiredGroups;
+		uint64_t swapCount = 0;
+
+		//i鲥ĿꣻsendAllʱ˷ʱط
+		EntitySpan multicastTargetsOf(const MessageQueue& q, const size_t i) const
 		{
-			//std::lock_guard lock(mutex);
-			messageList.remove(id);
+			const TargetGroupId group = q.multicastGroups[i];
+			if (group == NULL_TARGET_GROUP)
+			{
+				return EntitySpan(q.multicastTargets.data() + q.multicastBegin(i), q.multicastEnds[i] - q.multicastBegin(i));
+			}
+			return group.value < targetGroups.size() ? EntitySpan(targetGroups[group.value]) : EntitySpan();
 		}
 
-		void sendAll()//ϢĿϢб
+		std::unordered_map<MessageTypeId, MessageCodec> codecs;
+		std::unordered_map<uint64_t, MessageCodec> codecsByKey;
+
+		//ߡسȡأδעϢдfalse
+		bool saveMessage(BinaryWriter& out, const MessageBase& msg)
 		{
-			std::lock_guard lock(mutex);
-			for (size_t i = 0; i < unicastActive().size(); ++i)
+			auto it = codecs.find(msg.getType());
+			if (it == codecs.end())
 			{
-				MessageUnicast(unicastActive()[i].get(), unicastTargetListActive()[i], messageList);
+				return false;
 			}
-			for (size_t i = 0; i < multicastActive().size(); ++i)
+			out.write(it->second.key);
+			out.write(msg.getSender());
+			const size_t length = out.reserveU64();
+			out.align();
+			const size_t begin = out.size();
+			it->second.write(out, msg);
+			out.patchU64(length, out.size() - begin);
+			return true;
+		}
+		//еδעͷnullptrݱԱ
+		OwnedMessage loadMessage(BinaryReader& in)
+		{
+			const uint64_t key = in.read<uint64_t>();
+			const entity sender = in.read<entity>();
+			const uint64_t length = in.read<uint64_t>();
+			in.align();
+			const uint8_t* payload = in.take(size_t(length));
+			auto it = codecsByKey.find(key);
+			if (payload == nullptr || it == codecsByKey.end())
 			{
-				MessageMulticast(multicastActive()[i].get(), multicastTargetListActive()[i], messageList);
+				return OwnedMessage(nullptr, nullptr);
 			}
-			for (size_t i = 0; i < broadcastActive().size(); ++i)
+			BinaryReader payloadReader(payload, size_t(length));
+			auto msg = it->second.read(payloadReader, sender, messageTypeManager);
+			if (!payloadReader.ok())
 			{
-				MessageBroadcast(broadcastActive()[i].get(), messageList);
+				in.fail();
+				return OwnedMessage(nullptr, nullptr);
 			}
+			return msg;
 		}
-
-		void sendAll(ThreadPool& tp)//ϢĿϢб
+		//һȫ尴ַ˳ϲдȡʱȫ빲
+		void saveQueue(BinaryWriter& out, const size_t index)
 		{
-			std::lock_guard lock(mutex);
+			size_t countOffset = out.reserveU64();
+			uint64_t count = 0;
+			forEachQueue(index, [&](const MessageQueue& queue)
+				{
+					for (size_t i = 0; i < queue.unicast.size(); ++i)
+					{
+						if (saveMessage(out, *queue.unicast[i]))
+						{
+							out.write(queue.unicastTargets[i]);
+							++count;
+						}
+					}
+				});
+			out.patchU64(countOffset, count);
+
+			countOffset = out.reserveU64();
+			count = 0;
+			forEachQueue(index, [&](const MessageQueue& queue)
+				{
+					for (size_t i = 0; i < queue.multicast.size(); ++i)
+					{
+						if (saveMessage(out, *queue.multicast[i]))
+						{
+							const EntitySpan targets = multicastTargetsOf(queue, i);
+							out.writeArray(targets.data, targets.size);
+							++count;
+						}
+					}
+				});
+			out.patchU64(countOffset, count);
 
-			auto r1 = tp.enqueue
-			(
-				[this]()
+			countOffset = out.reserveU64();
+			count = 0;
+			forEachQueue(index, [&](const MessageQueue& queue)
 				{
-					for (size_t i = 0; i < unicastActive().size(); ++i)
+					for (auto msg : queue.broadcast)
 					{
-						MessageUnicast(unicastActive()[i].get(), unicastTargetListActive()[i], messageList);
+						count += saveMessage(out, *msg);
 					}
+				});
+			out.patchU64(countOffset, count);
+		}
+		bool loadQueue(BinaryReader& in, MessageQueue& queue)
+		{
+			uint64_t count = in.read<uint64_t>();
+			for (uint64_t i = 0; i < count && in.ok(); ++i)
+			{
+				auto msg = loadMessage(in);
+				const entity target = in.read<entity>();
+				if (msg)
+				{
+					queue.unicast.push_back(queue.adopt(std::move(msg)));
+					queue.unicastTargets.push_back(target);
+				}
+			}
+			count = in.read<uint64_t>();
+			for (uint64_t i = 0; i < count && in.ok(); ++i)
+			{
+				auto msg = loadMessage(in);
+				std::vector<entity> targets;
+				in.readArray(targets);
+				if (msg)
+				{
+					queue.pushMulticast(queue.adopt(std::move(msg)), EntitySpan(targets));
 				}
-			);
-			auto r2 = tp.enqueue
-			(
-				[this]()
+			}
+			count = in.read<uint64_t>();
+			for (uint64_t i = 0; i < count && in.ok(); ++i)
+			{
+				auto msg = loadMessage(in);
+				if (msg)
+				{
+					queue.broadcast.push_back(queue.adopt(std::move(msg)));
+				}
+			}
+			return in.ok();
+		}
+
+
+		void deliverAll(const size_t index)
+		{
+			forEachQueue(index, [this](MessageQueue& q)
+				{
+					directSent = directSent || !q.unicast.empty() || !q.multicast.empty();
+					for (size_t i = 0; i < q.unicast.size(); ++i)
+					{
+						deliver(q.unicast[i], &q.unicastTargets[i], 1);
+					}
+				});
+			forEachQueue(index, [this](MessageQueue& q)
 				{
-					for (size_t i = 0; i < multicastActive().size(); ++i)
+					for (size_t i = 0; i < q.multicast.size(); ++i)
 					{
-						MessageMulticast(multicastActive()[i].get(), multicastTargetListActive()[i], messageList);
+						const EntitySpan targets = multicastTargetsOf(q, i);
+						deliver(q.multicast[i], targets.data, targets.size);
 					}
+				});
+			forEachQueue(index, [this](MessageQueue& q)
+				{
+					broadcastFrame.insert(broadcastFrame.end(), q.broadcast.begin(), q.broadcast.end());
+				});
+		}
+
+		void insertHandler(const HandlerKey key, const MessageHandlerId id, std::unique_ptr<MessageHandlerBase> handler)
+		{
+			auto& list = handlers[key];
+			if (list.empty())
+			{
+				handledTargets[key.type].push_back(key.target);
+			}
+			list.push_back(HandlerEntry{ id, std::move(handler) });
+			handlerKeys.emplace(id, key);
+		}
+		void eraseHandler(const MessageHandlerId id)
+		{
+			auto keyIt = handlerKeys.find(id);
+			if (keyIt == handlerKeys.end())
+			{
+				return;
+			}
+			const HandlerKey key = keyIt->second;
+			handlerKeys.erase(keyIt);
+			auto it = handlers.find(key);
+			auto& list = it->second;
+			list.erase(std::find_if(list.begin(), list.end(), [id](const HandlerEntry& entry) { return entry.id == id; }));
+			if (list.empty())
+			{
+				handlers.erase(it);
+				auto& targets = handledTargets[key.type];
+				targets.erase(std::find(targets.begin(), targets.end(), key.target));
+				if (targets.empty())
+				{
+					handledTargets.erase(key.type);
 				}
-			);
-			auto r3 = tp.enqueue
-			(
-				[this]()
+			}
+		}
+		//ַڼ䴦䣬ɾƳٵַ
+		template<typename Func>
+		void changeHandlers(Func&& change)
+		{
+			if (dispatching)
+			{
+				pendingHandlerChanges.emplace_back(std::forward<Func>(change));
+			}
+			else
+			{
+				change();
+			}
+		}
+
+		void invokeHandlers(const MessageBase& msg, const entity target)
+		{
+			auto it = handlers.find(HandlerKey{ msg.getType(), target });
+			if (it == handlers.end())
+			{
+				return;
+			}
+			for (auto& entry : it->second)
+			{
+				entry.handler->handle(msg);
+			}
+			const MessageTypeId type = msg.getType();
+			if (type >= frameDispatchCounts.size())
+			{
+				frameDispatchCounts.resize(type + 1, 0);
+			}
+			if (frameDispatchCounts[type] == 0)
+			{
+				dispatchedTypes.push_back(type);
+			}
+			frameDispatchCounts[type] += it->second.size();
+		}
+		//ôпԷϢһ֡ȡϢбɾ
+		void dispatch(const size_t index)
+		{
+			if (handlers.empty())
+			{
+				return;
+			}
+			dispatching = true;
+			forEachQueue(index, [this](MessageQueue& q)
+				{
+					for (size_t i = 0; i < q.unicast.size(); ++i)
+					{
+						invokeHandlers(*q.unicast[i], q.unicastTargets[i]);
+					}
+				});
+			forEachQueue(index, [this](MessageQueue& q)
+				{
+					for (size_t i = 0; i < q.multicast.size(); ++i)
+					{
+						for (auto target : multicastTargetsOf(q, i))
+						{
+							invokeHandlers(*q.multicast[i], target);
+						}
+					}
+				});
+			forEachQueue(index, [this](MessageQueue& q)
 				{
-					for (size_t i = 0; i < broadcastActive().size(); ++i)
+					for (auto msg : q.broadcast)
 					{
-						MessageBroadcast(broadcastActive()[i].get(), messageList);
+						auto it = handledTargets.find(msg->getType());
+						if (it != handledTargets.end())
+						{
+							for (auto target : it->second)
+							{
+								invokeHandlers(*msg, target);
+							}
+						}
 					}
+				});
+			dispatching = false;
+
+			{
+				std::lock_guard lock(mutex);
+				if (dispatchCounts.size() < frameDispatchCounts.size())
+				{
+					dispatchCounts.resize(frameDispatchCounts.size(), 0);
+				}
+				for (auto type : dispatchedTypes)
+				{
+					dispatchCounts[type] += frameDispatchCounts[type];
+				}
+			}
+			for (auto type : dispatchedTypes)
+			{
+				if (dispatchHook)
+				{
+					dispatchHook(type, frameDispatchCounts[type]);
 				}
-			);
-			r1.wait();
-			r2.wait();
-			r3.wait();
+				frameDispatchCounts[type] = 0;
+			}
+			dispatchedTypes.clear();
+
+			std::lock_guard lock(mutex);
+			for (auto& change : pendingHandlerChanges)
+			{
+				change();
+			}
+			pendingHandlerChanges.clear();
+		}
+
+	public:
+		//ڷǻԾarenaֱӹϢswapʱգ
+		//msgMgr.addUnicastMessage<ButtonPressMsg>(target, senderId, typeId);
+		template<typename T, typename ...Args>
+		MessageManager& addUnicastMessage(entity targetId, Args&&...args)
+		{
+			stage([&](MessageQueue& q)
+				{
+					q.unicast.push_back(q.arena.create<T>(std::forward<Args>(args)...));
+					q.unicastTargets.push_back(targetId);
+				});
+			return *this;
+		}
+		//Ŀ긴ƽĿȶٷڴ
+		template<typename T, typename ...Args>
+		MessageManager& addMulticastMessage(EntitySpan targetIds, Args&&...args)
+		{
+			stage([&](MessageQueue& q)
+				{
+					q.pushMulticast(q.arena.create<T>(std::forward<Args>(args)...), targetIds);
+				});
+			return *this;
+		}
+		template<typename T, typename ...Args>
+		MessageManager& addMulticastMessage(std::initializer_list<entity> targetIds, Args&&...args)
+		{
+			return addMulticastMessage<T>(EntitySpan(targetIds.begin(), targetIds.size()), std::forward<Args>(args)...);
+		}
+		//ֻ¼ţĿΪsendAllʱĳԱ
+		template<typename T, typename ...Args>
+		MessageManager& addMulticastMessage(TargetGroupId group, Args&&...args)
+		{
+			stage([&](MessageQueue& q)
+				{
+					q.pushMulticast(q.arena.create<T>(std::forward<Args>(args)...), group);
+				});
+			return *this;
+		}
+		template<typename T, typename ...Args>
+		MessageManager& addBroadcastMessage(Args&&...args)
+		{
+			stage([&](MessageQueue& q)
+				{
+					q.broadcast.push_back(q.arena.create<T>(std::forward<Args>(args)...));
+				});
+			return *this;
 		}
 
-		void swap()//ԾϢѷϢУлԾ
+		template<typename T>
+		MessageManager& addUnicastMessage(std::unique_ptr<T>&& msg, entity targetId)
+		{
+			stage([&](MessageQueue& q)
+				{
+					q.unicast.push_back(q.adopt(OwnMessage(std::move(msg))));
+					q.unicastTargets.push_back(targetId);
+				});
+			return *this;
+		}
+		template<typename T>
+		MessageManager& addMulticastMessage(std::unique_ptr<T>&& msg, EntitySpan targetIds)
+		{
+			stage([&](MessageQueue& q)
+				{
+					q.pushMulticast(q.adopt(OwnMessage(std::move(msg))), targetIds);
+				});
+			return *this;
+		}
+		template<typename T>
+		MessageManager& addMulticastMessage(std::unique_ptr<T>&& msg, std::initializer_list<entity> targetIds)
+		{
+			return addMulticastMessage(std::move(msg), EntitySpan(targetIds.begin(), targetIds.size()));
+		}
+		template<typename T>
+		MessageManager& addBroadcastMessage(std::unique_ptr<T>&& msg)
+		{
+			stage([&](MessageQueue& q)
+				{
+					q.broadcast.push_back(q.adopt(OwnMessage(std::move(msg))));
+				});
+			return *this;
+		}
+
+		//صĺϲͼһswapǰЧδĵʵ巵nullptr
+		MessageInbox* getMessageList(entity id)
+		{
+			std::lock_guard lock(mutex);
+			return messageList.get(id);
+		}
+
+		//sendAllT͡ĿΪtargetĵ鲥ԼT͵ȫ㲥ֱӽfunc(const T&)
+		//ͬһ֡ڵĵ˳ϢбͬfuncڵsendAllִ߳
+		//msgMgr.addHandler<ButtonPressMsg>(button, [&](const ButtonPressMsg& msg) { ... });
+		template<typename T, typename Func>
+		MessageHandlerId addHandler(entity target, Func&& func)
+		{
+			std::lock_guard lock(mutex);
+			const HandlerKey key{ messageTypeManager.registeredType<T>(), target };
+			const MessageHandlerId id = nextHandlerId++;
+			auto handler = std::make_unique<MessageHandler<T, std::decay_t<Func>>>(std::forward<Func>(func));
+			changeHandlers([this, key, id, handler = std::move(handler)]() mutable { insertHandler(key, id, std::move(handler)); });
+			return id;
+		}
+		void removeHandler(MessageHandlerId id)
+		{
+			std::lock_guard lock(mutex);
+			changeHandlers([this, id]() { eraseHandler(id); });
+		}
+
+		//ÿsendAll󣬶Աεùÿ͵hook(type, ô)
+		void setDispatchHook(std::function<void(MessageTypeId, uint64_t)> hook)
+		{
+			std::lock_guard lock(mutex);
+			dispatchHook = std::move(hook);
+		}
+		uint64_t getDispatchCount(MessageTypeId type) const//ۼƵĴôڽеķַ
+		{
+			std::lock_guard lock(mutex);
+			return type < dispatchCounts.size() ? dispatchCounts[type] : 0;
+		}
+
+		//ɾûϢַʱУϵͳл֮֡䣩޸ĶδsendAll鲥ͬЧ
+		TargetGroupId createTargetGroup(EntitySpan targets = EntitySpan())
+		{
+			std::lock_guard lock(mutex);
+			if (!retiredGroups.empty() && swapCount - retiredGroups.front().second >= 2)
+			{
+				const uint32_t group = retiredGroups.front().first;
+				retiredGroups.erase(retiredGroups.begin());
+				targetGroups[group].assign(targets.begin(), targets.end());
+				return TargetGroupId(group);
+			}
+			targetGroups.emplace_back(targets.begin(), targets.end());
+			return TargetGroupId(uint32_t(targetGroups.size() - 1));
+		}
+		void setTargetGroup(TargetGroupId group, EntitySpan targets)
+		{
+			std::lock_guard lock(mutex);
+			if (group.value < targetGroups.size())
+			{
+				targetGroups[group.value].assign(targets.begin(), targets.end());
+			}
+		}
+		void addToTargetGroup(TargetGroupId group, entity target)
+		{
+			std::lock_guard lock(mutex);
+			if (group.value < targetGroups.size())
+			{
+				targetGroups[group.value].push_back(target);
+			}
+		}
+		void removeFromTargetGroup(TargetGroupId group, entity target)
+		{
+			std::lock_guard lock(mutex);
+			if (group.value < targetGroups.size())
+			{
+				auto& members = targetGroups[group.value];
+				members.erase(std::remove(members.begin(), members.end(), target), members.end());
+			}
+		}
+		//δ͵ĸ鲥ʹκĿꣻswap֮createTargetGroup
+		void destroyTargetGroup(TargetGroupId group)
 		{
 			std::lock_guard lock(mutex);
-			messageList.forEach
-			(
-				[](entity id, std::vector<MessageBase*>& list) {list.clear(); }
-			);
-			unicastActive().clear();
-			multicastActive().clear();
-			broadcastActive().clear();
-			
-			unicastTargetListActive().clear();
-			multicastTargetListActive().clear();
+			if (group.value >= targetGroups.size())
+			{
+				return;
+			}
+			for (auto& retired : retiredGroups)
+			{
+				if (retired.first == group.value)
+				{
+					return;
+				}
+			}
+			std::vector<entity>().swap(targetGroups[group.value]);
+			retiredGroups.emplace_back(group.value, swapCount);
+		}
+
+		MessageTypeManager& getMessageTypeManager() { return messageTypeManager; };
+
+		//עδϢдգδעϢΪ˲ʱϢʱ
+		template<typename T>
+		MessageManager& registerSerializable()
+		{
+			std::lock_guard lock(mutex);
+			MessageCodec codec;
+			codec.key = strHash(Serializer<T>::name);
+			codec.write = [](BinaryWriter& out, const MessageBase& msg) { Serializer<T>::write(out, static_cast<const T&>(msg)); };
+			codec.read = [](BinaryReader& in, entity sender, MessageTypeManager& types) -> OwnedMessage
+				{
+					return OwnMessage(Serializer<T>::read(in, sender, types.registeredType<T>()));
+				};
+			codecs[messageTypeManager.registeredType<T>()] = codec;
+			codecsByKey[codec.key] = codec;
+			return *this;
+		}
+
+		//գ߼δϢ֮֡
+		void save(BinaryWriter& out)
+		{
+			std::lock_guard lock(mutex);
+			const auto& subscribers = messageList.entities();
+			out.writeArray(subscribers.data(), subscribers.size());
+			saveQueue(out, activeIndex());
+			saveQueue(out, inactiveIndex());
+		}
+		bool load(BinaryReader& in)//ȶȫ滻ʧʱıκ״̬
+		{
+			std::lock_guard lock(mutex);
+			std::vector<entity> subscribers;
+			MessageQueue loaded[2];
+			if (!in.readArray(subscribers) || !loadQueue(in, loaded[0]) || !loadQueue(in, loaded[1]))
+			{
+				return false;
+			}
+			messageList.clear();
+			broadcastFrame.clear();
+			directSent = false;
+			forEachQueue(0, [](MessageQueue& q) { q.clear(); });
+			forEachQueue(1, [](MessageQueue& q) { q.clear(); });
+			for (auto id : subscribers)
+			{
+				messageList.add(id, MessageInbox(&broadcastFrame));
+			}
+			shared[activeIndex()].replaceWith(loaded[0]);
+			shared[inactiveIndex()].replaceWith(loaded[1]);
+			return true;
+		}
 
+		void subscribe(entity id)//ϢκδϢʵ岻յκϢĺ󽫽չ㲥ϢΪĿʱ鲥/Ϣ
+		{
+			//std::lock_guard lock(mutex);
+			messageList.add(id, MessageInbox(&broadcastFrame));
+		}
+		void unsubscribe(entity id)//ȡģյκϢ
+		{
+			//std::lock_guard lock(mutex);
+			messageList.remove(id);
+		}
+
+		void sendAll()//ϢĿϢбٵô
+		{
+			size_t index;
+			{
+				std::lock_guard lock(mutex);
+				index = activeIndex();
+				deliverAll(index);
+			}
+			dispatch(index);
+		}
+
+		void swap()//֡Ϣб빲㲥блԾarenaеϢ
+		{
+			std::lock_guard lock(mutex);
+			if (directSent)
+			{
+				messageList.forEach([](entity, MessageInbox& inbox) { inbox.direct.clear(); });
+				directSent = false;
+			}
+			broadcastFrame.clear();
+			forEachQueue(activeIndex(), [](MessageQueue& q) { q.clear(); });
 
 			active = !active;
+			++swapCount;
 		}
 	};
 
-	using MessageList = ComponentPool<std::vector<MessageBase*>>;
+	using MessageList = ComponentPool<MessageInbox>;
 }
\ No newline at end of file
@@ -0,0 +1,335 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+#include <type_traits>
+
+#ifdef _WIN32
+//windows.hraylibͬͻ
+extern "C"
+{
+	struct _SECURITY_ATTRIBUTES;
+	__declspec(dllimport) void* __stdcall CreateFileA(const char*, unsigned long, unsigned long, _SECURITY_ATTRIBUTES*, unsigned long, unsigned long, void*);
+	__declspec(dllimport) unsigned long __stdcall GetFileSize(void*, unsigned long*);
+	__declspec(dllimport) void* __stdcall CreateFileMappingA(void*, _SECURITY_ATTRIBUTES*, unsigned long, unsigned long, unsigned long, const char*);
+	__declspec(dllimport) void* __stdcall MapViewOfFile(void*, unsigned long, unsigned long, unsigned long, size_t);
+	__declspec(dllimport) int __stdcall UnmapViewOfFile(const void*);
+	__declspec(dllimport) int __stdcall CloseHandle(void*);
+}
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace ecs
+{
+	//鸴Ƶݰ˶룬ȡʱֱӴӻƵ
+	constexpr size_t SNAPSHOT_ALIGN = 16;
+
+	class BinaryWriter
+	{
+	private:
+		std::vector<uint8_t> buffer;
+
+	public:
+		void write(const void* data, const size_t size)
+		{
+			const size_t offset = buffer.size();
+			buffer.resize(offset + size);
+			if (size > 0)
+			{
+				std::memcpy(buffer.data() + offset, data, size);
+			}
+		}
+		template<typename T>
+		void write(const T& value)
+		{
+			static_assert(std::is_trivially_copyable_v<T>, "only trivially copyable values can be written directly");
+			write(&value, sizeof(T));
+		}
+		void writeString(const std::string& str)
+		{
+			write(uint64_t(str.size()));
+			write(str.data(), str.size());
+		}
+		//Ԫ䡢
+		template<typename T>
+		void writeArray(const T* data, const size_t count)
+		{
+			static_assert(std::is_trivially_copyable_v<T>, "only trivially copyable arrays can be written directly");
+			write(uint64_t(count));
+			align();
+			write(data, count * sizeof(T));
+		}
+		void align(const size_t alignment = SNAPSHOT_ALIGN)
+		{
+			buffer.resize((buffer.size() + alignment - 1) / alignment * alignment, 0);
+		}
+		//ռλдһκٻ䳤
+		size_t reserveU64()
+		{
+			const size_t offset = buffer.size();
+			write(uint64_t(0));
+			return offset;
+		}
+		void patchU64(const size_t offset, const uint64_t value)
+		{
+			std::memcpy(buffer.data() + offset, &value, sizeof(value));
+		}
+		size_t size() const
+		{
+			return buffer.size();
+		}
+		void reserve(const size_t size)
+		{
+			buffer.reserve(size);
+		}
+		std::vector<uint8_t>& data()
+		{
+			return buffer;
+		}
+	};
+
+	//һֻڴ϶ȡӳļԽfailȡȫؿ
+	class BinaryReader
+	{
+	private:
+		const uint8_t* begin;
+		const uint8_t* cursor;
+		const uint8_t* end;
+		bool failed = false;
+
+	public:
+		BinaryReader(const uint8_t* data, const size_t size) : begin(data), cursor(data), end(data + size) {}
+
+		//ȡýsizeֽڵָ벢ǰʱnullptr
+		const uint8_t* take(const size_t size)
+		{
+			if (failed || size_t(end - cursor) < size)
+			{
+				failed = true;
+				return nullptr;
+			}
+			const uint8_t* result = cursor;
+			cursor += size;
+			return result;
+		}
+		bool read(void* out, const size_t size)
+		{
+			const uint8_t* p = take(size);
+			if (p == nullptr)
+			{
+				return false;
+			}
+			if (size > 0)
+			{
+				std::memcpy(out, p, size);
+			}
+			return true;
+		}
+		template<typename T>
+		T read()
+		{
+			static_assert(std::is_trivially_copyable_v<T> && std::is_default_constructible_v<T>, "only trivially copyable values can be read directly");
+			T result{};
+			read(&result, sizeof(T));
+			return result;
+		}
+		std::string readString()
+		{
+			const uint64_t size = read<uint64_t>();
+			const uint8_t* p = take(size_t(size));
+			return p == nullptr ? std::string() : std::string(reinterpret_cast<const char*>(p), size_t(size));
+		}
+		//writeArrayӦֱӴӻ鸴Ƶoutʼַ谴SNAPSHOT_ALIGN
+		template<typename T>
+		bool readArray(std::vector<T>& out)
+		{
+			static_assert(std::is_trivially_copyable_v<T>, "only trivially copyable arrays can be read directly");
+			const uint64_t count = read<uint64_t>();
+			align();
+			if (failed || count > remaining() / sizeof(T))
+			{
+				failed = true;
+				return false;
+			}
+			const uint8_t* p = take(size_t(count) * sizeof(T));
+			if (reinterpret_cast<uintptr_t>(p) % alignof(T) != 0)
+			{
+				failed = true;
+				return false;
+			}
+			const T* first = reinterpret_cast<const T*>(p);
+			out.assign(first, first + count);
+			return true;
+		}
+		void align(const size_t alignment = SNAPSHOT_ALIGN)
+		{
+			const size_t offset = cursor - begin;
+			take((offset + alignment - 1) / alignment * alignment - offset);
+		}
+		void skip(const size_t size)
+		{
+			take(size);
+		}
+		void fail()
+		{
+			failed = true;
+		}
+		bool ok() const
+		{
+			return !failed;
+		}
+		size_t offset() const
+		{
+			return cursor - begin;
+		}
+		size_t remaining() const
+		{
+			return end - cursor;
+		}
+	};
+
+	//ϢлʽĬϲлл
+	//POD̳PodSerializer鸴ƣ
+	//template<> struct ecs::Serializer<Com> : ecs::PodSerializer<Com> { static constexpr const char* name = "Com"; };
+	//enabledΪtrueṩ static void write(BinaryWriter&, const T&)  static T read(BinaryReader&)
+	//Ϣṩ write  static std::unique_ptr<T> read(BinaryReader&, entity sender, MessageTypeId type)
+	//nameڿбʶͣɿеĶӦݽ
+	template<typename T>
+	struct Serializer
+	{
+		static constexpr bool enabled = false;
+	};
+	template<typename T>
+	struct PodSerializer
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "PodSerializer requires a trivially copyable type");
+		static constexpr bool enabled = true;
+	};
+	template<typename T>
+	constexpr bool IsPodSerialized = std::is_base_of_v<PodSerializer<T>, Serializer<T>>;
+
+	//ֻӳļʧʱvalid()Ϊfalse
+	class MappedFile
+	{
+	private:
+		const uint8_t* ptr = nullptr;
+		size_t length = 0;
+#ifdef _WIN32
+		void* file = nullptr;
+		void* mapping = nullptr;
+#else
+		int fd = -1;
+#endif
+
+	public:
+		explicit MappedFile(const char* path)
+		{
+#ifdef _WIN32
+			constexpr unsigned long GENERIC_READ_ACCESS = 0x80000000ul;
+			constexpr unsigned long SHARE_READ = 0x1;
+			constexpr unsigned long OPEN_EXISTING_FILE = 3;
+			constexpr unsigned long ATTRIBUTE_NORMAL = 0x80;
+			constexpr unsigned long PAGE_READ = 0x02;
+			constexpr unsigned long MAP_READ = 0x0004;
+			void* const INVALID = reinterpret_cast<void*>(intptr_t(-1));
+
+			file = CreateFileA(path, GENERIC_READ_ACCESS, SHARE_READ, nullptr, OPEN_EXISTING_FILE, ATTRIBUTE_NORMAL, nullptr);
+			if (file == INVALID)
+			{
+				file = nullptr;
+				return;
+			}
+			unsigned long high = 0;
+			const unsigned long low = GetFileSize(file, &high);
+			const size_t size = size_t((uint64_t(high) << 32) | low);
+			if (size == 0)
+			{
+				return;
+			}
+			mapping = CreateFileMappingA(file, nullptr, PAGE_READ, 0, 0, nullptr);
+			if (mapping == nullptr)
+			{
+				return;
+			}
+			ptr = static_cast<const uint8_t*>(MapViewOfFile(mapping, MAP_READ, 0, 0, 0));
+			length = ptr == nullptr ? 0 : size;
+#else
+			fd = open(path, O_RDONLY);
+			if (fd < 0)
+			{
+				return;
+			}
+			struct stat st;
+			if (fstat(fd, &st) != 0 || st.st_size == 0)
+			{
+				return;
+			}
+			void* p = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+			if (p == MAP_FAILED)
+			{
+				return;
+			}
+			ptr = static_cast<const uint8_t*>(p);
+			length = size_t(st.st_size);
+#endif
+		}
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		~MappedFile()
+		{
+#ifdef _WIN32
+			if (ptr != nullptr)
+			{
+				UnmapViewOfFile(ptr);
+			}
+			if (mapping != nullptr)
+			{
+				CloseHandle(mapping);
+			}
+			if (file != nullptr)
+			{
+				CloseHandle(file);
+			}
+#else
+			if (ptr != nullptr)
+			{
+				munmap(const_cast<uint8_t*>(ptr), length);
+			}
+			if (fd >= 0)
+			{
+				close(fd);
+			}
+#endif
+		}
+		const uint8_t* data() const
+		{
+			return ptr;
+		}
+		size_t size() const
+		{
+			return length;
+		}
+		bool valid() const
+		{
+			return ptr != nullptr;
+		}
+	};
+
+	inline bool WriteFileBytes(const char* path, const std::vector<uint8_t>& bytes)
+	{
+		FILE* file = std::fopen(path, "wb");
+		if (file == nullptr)
+		{
+			return false;
+		}
+		const bool result = std::fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+		return std::fclose(file) == 0 && result;
+	}
+}
@@ -14,6 +14,223 @@ namespace ui
 	public:
 		ButtonPressMsg(ecs::entity senderId, ecs::MessageTypeId typeId) : MessageBase(senderId, typeId) {}
 	};
+}
+
+namespace ecs
+{
+	template<>
+	struct Serializer<ui::ButtonPressMsg> : EmptyMessageSerializer<ui::ButtonPressMsg>
+	{
+		static constexpr const char* name = "ui::ButtonPressMsg";
+	};
+}
+
+namespace ui
+{
+	//ؼlayerϣͬʱȵǼǵ
+	struct HitArea
+	{
+		ecs::AABB bounds;
+		bool circle = false;//ԲboundsΪԲġx볤Ϊ뾶
+		int layer = 0;
+
+		bool contains(const Vector2 point) const
+		{
+			if (circle)
+			{
+				const float r = bounds.getXHarfLength();
+				return Vector2DistanceSqr(point, bounds.getPosition()) <= r * r;
+			}
+			return bounds.isIncluding(point);
+		}
+	};
+
+	//пؼõвؼÿ֡ǼԼ򣬼βʱĶĲ
+	//ÿֻ֡һ꣬һβѯʱĲнϲĿؼ֮Ĳѯֱӷؽ
+	//ͬһʵֻܵǼһ
+	class HitTestIndex
+	{
+	private:
+		struct Entry
+		{
+			HitArea area;
+			uint64_t seen;
+			uint64_t order;
+		};
+
+		ecs::QuadTree tree;
+		std::unordered_map<ecs::entity, Entry> entries;
+		std::vector<ecs::entity> candidates;
+		std::vector<ecs::entity> stale;
+
+		uint64_t frame = 0;
+		uint64_t nextOrder = 0;
+
+		Vector2 mouse = { 0.0f, 0.0f };
+		bool pressedFlag = false;
+		bool releasedFlag = false;
+		bool downFlag = false;
+
+		ecs::entity hoveredId = ecs::NULL_ENTITY;
+		bool resolved = false;
+
+		void resolve()
+		{
+			candidates.clear();
+			tree.query(ecs::AABB(mouse, 0.0f), candidates);
+			hoveredId = ecs::NULL_ENTITY;
+			const Entry* best = nullptr;
+			for (ecs::entity id : candidates)
+			{
+				const Entry& e = entries.find(id)->second;
+				if (!e.area.contains(mouse))
+				{
+					continue;
+				}
+				if (best == nullptr || e.area.layer > best->area.layer || (e.area.layer == best->area.layer && e.order > best->order))
+				{
+					best = &e;
+					hoveredId = id;
+				}
+			}
+			resolved = true;
+		}
+
+	public:
+		explicit HitTestIndex(ecs::AABB screen) : tree(screen) {}
+
+		//֡룬Ƴһ֡ûеǼǵĿؼ
+		void beginFrame()
+		{
+			++frame;
+			mouse = GetMousePosition();
+			pressedFlag = IsMouseButtonPressed(MOUSE_BUTTON_LEFT);
+			releasedFlag = IsMouseButtonReleased(MOUSE_BUTTON_LEFT);
+			downFlag = IsMouseButtonDown(MOUSE_BUTTON_LEFT);
+			resolved = false;
+
+			stale.clear();
+			for (auto& [id, e] : entries)
+			{
+				if (e.seen + 1 < frame)
+				{
+					stale.push_back(id);
+				}
+			}
+			for (ecs::entity id : stale)
+			{
+				remove(id);
+			}
+		}
+		void track(ecs::entity id, const HitArea& area)
+		{
+			auto it = entries.find(id);
+			if (it == entries.end())
+			{
+				entries.emplace(id, Entry{ area, frame, nextOrder++ });
+				tree.add(id, area.bounds);
+				resolved = false;
+				return;
+			}
+			Entry& e = it->second;
+			e.seen = frame;
+			const ecs::AABB& old = e.area.bounds;
+			if (old.getPosition().x != area.bounds.getPosition().x || old.getPosition().y != area.bounds.getPosition().y ||
+				old.getXHarfLength() != area.bounds.getXHarfLength() || old.getYHarfLength() != area.bounds.getYHarfLength())
+			{
+				tree.move(id, area.bounds);
+				resolved = false;
+			}
+			if (e.area.circle != area.circle || e.area.layer != area.layer)
+			{
+				resolved = false;
+			}
+			e.area = area;
+		}
+		void remove(ecs::entity id)
+		{
+			if (entries.erase(id) > 0)
+			{
+				tree.remove(id);
+				resolved = false;
+			}
+		}
+		ecs::entity hovered()//ϲĿؼûΪNULL_ENTITY
+		{
+			if (!resolved)
+			{
+				resolve();
+			}
+			return hoveredId;
+		}
+		bool isHovered(ecs::entity id)
+		{
+			return hovered() == id;
+		}
+		bool pressed() const
+		{
+			return pressedFlag;
+		}
+		bool released() const
+		{
+			return releasedFlag;
+		}
+		bool down() const
+		{
+			return downFlag;
+		}
+		Vector2 mousePosition() const
+		{
+			return mouse;
+		}
+		size_t size() const
+		{
+			return entries.size();
+		}
+	};
+
+	//пؼϵͳ֮ǰִУɵһApplyؼĺע
+	class HitTestSystem : public ecs::SystemBase
+	{
+	private:
+		std::shared_ptr<HitTestIndex> hits;
+
+	public:
+		explicit HitTestSystem(std::shared_ptr<HitTestIndex> hits) : hits(std::move(hits)) {}
+
+		const char* name() const override
+		{
+			return "ui::HitTestSystem";
+		}
+
+		ecs::SystemAccess access() const override
+		{
+			return ecs::SystemAccess::Shared().write(hits.get()).input();
+		}
+
+		void update() override
+		{
+			hits->beginFrame();
+		}
+
+		HitTestIndex* index() const
+		{
+			return hits.get();
+		}
+	};
+
+	HitTestIndex* HitTestOf(ecs::World2D& world)
+	{
+		if (HitTestSystem* sys = world.getSystem<HitTestSystem>())
+		{
+			return sys->index();
+		}
+		const float w = float(GetScreenWidth());
+		const float h = float(GetScreenHeight());
+		auto hits = std::make_shared<HitTestIndex>(ecs::AABB({ w * 0.5f, h * 0.5f }, w * 0.5f, h * 0.5f));
+		world.addSystem(HitTestSystem(hits));
+		return hits.get();
+	}
 
 	struct ButtonCom
 	{
@@ -144,19 +361,31 @@ namespace ui
 		std::array<std::vector<std::unique_ptr<ecs::DrawBase>>, 16>& uiLayer;
 
 		std::shared_ptr<std::vector<ecs::entity>> buttonIds;
-		std::shared_ptr<std::vector<std::vector<ecs::entity>>> listeners;
+		std::shared_ptr<std::vector<ecs::TargetGroupId>> listeners;//ÿťļߵǼΪϢеһ
+
+		HitTestIndex* hits;
 
 		ecs::MessageTypeId messageTypeId;
 
 	public:
-		ButtonSystem(ecs::DoubleComs<ButtonCom>* b, ecs::MessageManager* m, std::array<std::vector<std::unique_ptr<ecs::DrawBase>>, 16>* uiLayer) : buttons(*b), msgmgr(*m), uiLayer(*uiLayer)
+		ButtonSystem(ecs::DoubleComs<ButtonCom>* b, ecs::MessageManager* m, std::array<std::vector<std::unique_ptr<ecs::DrawBase>>, 16>* uiLayer, HitTestIndex* hits) : buttons(*b), msgmgr(*m), uiLayer(*uiLayer), hits(hits)
 		{
 			buttonIds = std::make_shared<std::vector<ecs::entity>>();
-			listeners = std::make_shared<std::vector<std::vector<ecs::entity>>>();
+			listeners = std::make_shared<std::vector<ecs::TargetGroupId>>();
 
 			messageTypeId = m->getMessageTypeManager().registeredType<ButtonPressMsg>();
+			m->registerSerializable<ButtonPressMsg>();
 		}
 
+		const char* name() const override
+		{
+			return "ui::ButtonSystem";
+		}
+
+		ecs::SystemAccess access() const override
+		{
+			return ecs::SystemAccess::Shared().read(&buttons).write(&uiLayer).write(hits).input();
+		}
 
 		void registerListener(ecs::entity buttonId, ecs::entity listenerId)
 		{
@@ -164,10 +393,23 @@ namespace ui
 			if (it == buttonIds.get()->end())
 			{
 				buttonIds.get()->push_back(buttonId);
-				listeners.get()->push_back(std::vector<ecs::entity>());
+				listeners.get()->push_back(msgmgr.createTargetGroup());
 				it = std::find(buttonIds.get()->begin(), buttonIds.get()->end(), buttonId);
 			}
-			(*listeners)[it - buttonIds.get()->begin()].push_back(listenerId);
+			msgmgr.addToTargetGroup((*listeners)[it - buttonIds.get()->begin()], listenerId);
+		}
+		//ɾťʱã飻֮¸ðťٷϢ
+		void unregisterButton(ecs::entity buttonId)
+		{
+			auto it = std::find(buttonIds.get()->begin(), buttonIds.get()->end(), buttonId);
+			if (it == buttonIds.get()->end())
+			{
+				return;
+			}
+			auto group = listeners.get()->begin() + (it - buttonIds.get()->begin());
+			msgmgr.destroyTargetGroup(*group);
+			listeners.get()->erase(group);
+			buttonIds.get()->erase(it);
 		}
 
 		ecs::MessageTypeId typeId() const//ȡϵͳµİťϢid
@@ -177,28 +419,19 @@ namespace ui
 
 		void update()//ͰϢ
 		{
-			auto release = IsMouseButtonReleased(MOUSE_BUTTON_LEFT);
-			Vector2 pos;
-			if (release)
+			if (hits->released())//ɿʱϲĿؼµİťȽ
 			{
-				pos = GetMousePosition();
+				ecs::entity id = hits->hovered();
+				auto it = std::find(buttonIds.get()->begin(), buttonIds.get()->end(), id);//ҶӦidļб
+				if (it != buttonIds.get()->end() && buttons.active()->contains(id))
+				{
+					msgmgr.addMulticastMessage<ButtonPressMsg>((*listeners)[it - buttonIds.get()->begin()], id, messageTypeId);
+				}
 			}
-			buttons.active()->forEach([release, pos, this](ecs::entity id, ButtonCom& button)
+			buttons.active()->forEach([this](ecs::entity id, ButtonCom& button)
 				{
-					if (release)
-					{
-						if (pos.x < button.x + button.width && pos.x > button.x && pos.y < button.y + button.height && pos.y > button.y)
-						{
-							auto it = std::find(buttonIds.get()->begin(), buttonIds.get()->end(), id);//ҶӦidļб
-							//msgmgr.addMessage(ButtonPressMsg(messageSysId, id));
-							if (it != buttonIds.get()->end())
-							{
-								msgmgr.addMulticastMessage(std::make_unique<ButtonPressMsg>(ButtonPressMsg(id, messageTypeId)), (*listeners)[it - buttonIds.get()->begin()]);
-							}
-						}
-					}
+					hits->track(id, HitArea{ ecs::AABB({ button.x + button.width * 0.5f, button.y + button.height * 0.5f }, button.width * 0.5f, button.height * 0.5f), false, 10 });
 					uiLayer[10].push_back(std::make_unique<ButtonDraw>(button));
-					int i = 1;
 				});
 
 		}
@@ -207,7 +440,8 @@ namespace ui
 	void ApplyButton(ecs::World2D& world)
 	{
 		world.addPool<ButtonCom>();
-		world.addSystem(std::move(ButtonSystem(world.getDoubleBuffer<ButtonCom>(), world.getMessageManager(), world.getUiLayer())));
+		HitTestIndex* hits = HitTestOf(world);
+		world.addSystem(std::move(ButtonSystem(world.getDoubleBuffer<ButtonCom>(), world.getMessageManager(), world.getUiLayer(), hits)));
 	}
 
 	struct ImageBoxCom
@@ -238,6 +472,17 @@ namespace ui
 
 	public:
 		ImageBoxSystem(ecs::DoubleComs<ImageBoxCom>* imageBoxes, ecs::Layers* layers) : imageBoxes(*imageBoxes), layers(*layers) {}
+
+		const char* name() const override
+		{
+			return "ui::ImageBoxSystem";
+		}
+
+		ecs::SystemAccess access() const override
+		{
+			return ecs::SystemAccess::Shared().read(&imageBoxes).write(&layers);
+		}
+
 		void update()
 		{
 			imageBoxes.active()->forEach
@@ -295,6 +540,16 @@ namespace ui
 	public:
 		TextBoxSystem(ecs::DoubleComs<TextBoxCom>* textBoxes, ecs::Layers* layer) : textBoxes(*textBoxes), layer(*layer) {}
 
+		const char* name() const override
+		{
+			return "ui::TextBoxSystem";
+		}
+
+		ecs::SystemAccess access() const override
+		{
+			return ecs::SystemAccess::Shared().read(&textBoxes).write(&layer);
+		}
+
 		void update() override
 		{
 			textBoxes.active()->forEach
@@ -409,15 +664,27 @@ namespace ui
 		ecs::DoubleComs<ButtonExCom>& buttons;
 		ecs::Layers& uiLayer;
 		ecs::MessageManager& msgMgr;
+		HitTestIndex* hits;
 
 		ecs::MessageTypeId messageTypeId;
 
 		rlRAII::RenderTexture2DRAII rt;
 
 	public:
-		ButtonExSystem(ecs::DoubleComs<ButtonExCom>* buttons, ecs::Layers* uiLayer, ecs::MessageManager* msgMgr) : buttons(*buttons), uiLayer(*uiLayer), msgMgr(*msgMgr)
+		ButtonExSystem(ecs::DoubleComs<ButtonExCom>* buttons, ecs::Layers* uiLayer, ecs::MessageManager* msgMgr, HitTestIndex* hits) : buttons(*buttons), uiLayer(*uiLayer), msgMgr(*msgMgr), hits(hits)
 		{
 			messageTypeId = msgMgr->getMessageTypeManager().registeredType<ButtonPressMsg>();
+			msgMgr->registerSerializable<ButtonPressMsg>();
+		}
+
+		const char* name() const override
+		{
+			return "ui::ButtonExSystem";
+		}
+
+		ecs::SystemAccess access() const override
+		{
+			return ecs::SystemAccess::Shared().write(&buttons).write(&uiLayer).write(hits).input();
 		}
 
 		void update() override
@@ -426,79 +693,28 @@ namespace ui
 			(
 				[this](ecs::entity id, ButtonExCom& button)
 				{
-					Vector2 mPos = GetMousePosition();
-					bool inBox = mPos.x < button.pos.x + button.coverage.x && mPos.x > button.pos.x && mPos.y < button.pos.y + button.coverage.y && mPos.y > button.pos.y;
-					if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT))
+					hits->track(id, HitArea{ ecs::AABB(button.pos + button.coverage * 0.5f, button.coverage.x * 0.5f, button.coverage.y * 0.5f), false, button.layerDepth });
+					bool inBox = hits->isHovered(id);
+					bool press = button.press;
+					if (hits->pressed() && inBox && !press)
 					{
-						if (inBox && button.press == false)
-						{
-							button.press = true;
-						}
+						press = true;
 					}
-					if (button.press)
+					else if (press && hits->released())
 					{
-						if (IsMouseButtonReleased(MOUSE_BUTTON_LEFT))
+						press = false;
+						if (inBox)
 						{
-							if (inBox)
-							{
-								button.press = false;
-								msgMgr.addUnicastMessage(std::make_unique<ButtonPressMsg>(ButtonPressMsg(id, messageTypeId)), id);
-							}
-							else
-							{
-								button.press = false;
-							}
+							msgMgr.addUnicastMessage<ButtonPressMsg>(id, id, messageTypeId);
 						}
 					}
-					if (inBox)
+					if (press != button.press)//״̬дǻԾ壬ʱͬ
 					{
-						if (button.press)
-						{
-							uiLayer[button.layerDepth].push_back(std::make_unique<ButtonExDraw>(ButtonExDraw(button, button.pressIcon)));
-						}
-						else
-						{
-							uiLayer[button.layerDepth].push_back(std::make_unique<ButtonExDraw>(ButtonExDraw(button, button.hoverIcon)));
-						}
-					}
-					else
-					{
-						uiLayer[button.layerDepth].push_back(std::make_unique<ButtonExDraw>(ButtonExDraw(button, button.baseIcon)));
-					}
-				}
-			);
-
-			buttons.inactive()->forEach
-			(
-				[this](ecs::entity id, ButtonExCom& button)
-				{
-					Vector2 mPos = GetMousePosition();
-					bool inBox = mPos.x < button.pos.x + button.coverage.x && mPos.x > button.pos.x && mPos.y < button.pos.y + button.coverage.y && mPos.y > button.pos.y;
-					if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT))
-					{
-						if (inBox && button.press == false)
-						{
-							button.press = true;
-						}
-					}
-					if (button.press)
-					{
-						if (IsMouseButtonReleased(MOUSE_BUTTON_LEFT))
-						{
-							if (inBox)
-							{
-								button.press = false;
-								msgMgr.addUnicastMessage(std::make_unique<ButtonPressMsg>(ButtonPressMsg(id, messageTypeId)), id);
-							}
-							else
-							{
-								button.press = false;
-							}
-						}
+						buttons.inactive()->modify(id)->press = press;
 					}
 					if (inBox)
 					{
-						if (button.press)
+						if (press)
 						{
 							uiLayer[button.layerDepth].push_back(std::make_unique<ButtonExDraw>(ButtonExDraw(button, button.pressIcon)));
 						}
@@ -520,7 +736,8 @@ namespace ui
 	void ApplyButtonEx(ecs::World2D& world)
 	{
 		world.addPool<ButtonExCom>();
-		world.addSystem(ButtonExSystem(world.getDoubleBuffer<ButtonExCom>(), world.getUiLayer(), world.getMessageManager()));
+		HitTestIndex* hits = HitTestOf(world);
+		world.addSystem(ButtonExSystem(world.getDoubleBuffer<ButtonExCom>(), world.getUiLayer(), world.getMessageManager(), hits));
 	}
 
 	class TextBoxExCom
@@ -626,6 +843,16 @@ namespace ui
 	public:
 		TextBoxExSystem(ecs::DoubleComs<TextBoxExCom>* textBoxes, ecs::Layers* layer) : textBoxesEx(*textBoxes), layer(*layer) {}
 
+		const char* name() const override
+		{
+			return "ui::TextBoxExSystem";
+		}
+
+		ecs::SystemAccess access() const override
+		{
+			return ecs::SystemAccess::Shared().read(&textBoxesEx).write(&layer);
+		}
+
 		void update() override
 		{
 			textBoxesEx.active()->forEach
@@ -658,6 +885,19 @@ namespace ui
 		SwitchCom(float radius, Color color, Vector2 position, int layerDepth) :
 			state(false), press(false), radius(radius), color(color), pos(position), s(0.0f), scale(0.0f), layerDepth(layerDepth) {}
 	};
+}
+
+namespace ecs
+{
+	template<>
+	struct Serializer<ui::SwitchCom> : PodSerializer<ui::SwitchCom>
+	{
+		static constexpr const char* name = "ui::SwitchCom";
+	};
+}
+
+namespace ui
+{
 
 	class SwitchDraw : public ecs::DrawBase
 	{
@@ -681,9 +921,20 @@ namespace ui
 	private:
 		ecs::DoubleComs<SwitchCom>* coms;
 		ecs::Layers* layers;
+		HitTestIndex* hits;
 
 	public:
-		SwitchSystem(ecs::DoubleComs<SwitchCom>* coms, ecs::Layers* layers) : coms(coms), layers(layers) {}
+		SwitchSystem(ecs::DoubleComs<SwitchCom>* coms, ecs::Layers* layers, HitTestIndex* hits) : coms(coms), layers(layers), hits(hits) {}
+
+		const char* name() const override
+		{
+			return "ui::SwitchSystem";
+		}
+
+		ecs::SystemAccess access() const override
+		{
+			return ecs::SystemAccess::Shared().write(coms).write(layers).write(hits).input();
+		}
 
 		void update() override
 		{
@@ -691,42 +942,53 @@ namespace ui
 			(
 				[this](ecs::entity id, SwitchCom& comActive)
 				{
-					auto& comInactive = *(coms->inactive()->get(id));
 					float deltaTime = GetFrameTime();
-					comInactive = comActive;
-					if (Vector2DistanceSqr(GetMousePosition(), comActive.pos) > comActive.radius * comActive.radius)
+					bool state = comActive.state;
+					bool press = comActive.press;
+					float s = comActive.s;
+					float scale = comActive.scale;
+					hits->track(id, HitArea{ ecs::AABB(comActive.pos, comActive.radius), true, comActive.layerDepth });
+					if (!hits->isHovered(id))
 					{
-						comInactive.s -= deltaTime * 6.0f;
-						comInactive.s = std::clamp(comInactive.s, 0.5f, 1.0f);
-						if (comActive.press && IsMouseButtonReleased(MOUSE_BUTTON_LEFT))
+						s -= deltaTime * 6.0f;
+						s = std::clamp(s, 0.5f, 1.0f);
+						if (comActive.press && hits->released())
 						{
-							comInactive.press = false;
+							press = false;
 						}
 					}
 					else
 					{
-						comInactive.s += deltaTime * 6.0f;
-						comInactive.s = std::clamp(comInactive.s, 0.0f, 1.0f);
-						if (IsMouseButtonReleased(MOUSE_BUTTON_LEFT) && comActive.press)
+						s += deltaTime * 6.0f;
+						s = std::clamp(s, 0.0f, 1.0f);
+						if (hits->released() && comActive.press)
 						{
-							comInactive.press = false;
-							comInactive.state = !comActive.state;
+							press = false;
+							state = !comActive.state;
 						}
-						else if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT) && !comActive.press)
+						else if (hits->pressed() && !comActive.press)
 						{
-							comInactive.press = true;
+							press = true;
 						}
 
 					}
 					if (comActive.state)
 					{
-						comInactive.scale += deltaTime * 20.0f;
-						comInactive.scale = std::clamp(comInactive.scale, 0.0f, 1.0f);
+						scale += deltaTime * 20.0f;
+						scale = std::clamp(scale, 0.0f, 1.0f);
 					}
 					else
 					{
-						comInactive.scale -= deltaTime * 20.0f;
-						comInactive.scale = std::clamp(comInactive.scale, 0.0f, 1.0f);
+						scale -= deltaTime * 20.0f;
+						scale = std::clamp(scale, 0.0f, 1.0f);
+					}
+					if (state != comActive.state || press != comActive.press || s != comActive.s || scale != comActive.scale)//ֹĿزд롢ͬ
+					{
+						SwitchCom& comInactive = *(coms->inactive()->modify(id));
+						comInactive.state = state;
+						comInactive.press = press;
+						comInactive.s = s;
+						comInactive.scale = scale;
 					}
 					(*layers)[comActive.layerDepth].push_back(std::make_unique<SwitchDraw>(SwitchDraw(comActive)));
 				}
@@ -737,7 +999,8 @@ namespace ui
 	void ApplySwitch(ecs::World2D& world)
 	{
 		world.addPool<SwitchCom>();
-		world.addSystem(SwitchSystem(world.getDoubleBuffer<SwitchCom>(), world.getUiLayer()));
+		HitTestIndex* hits = HitTestOf(world);
+		world.addSystem(SwitchSystem(world.getDoubleBuffer<SwitchCom>(), world.getUiLayer(), hits));
 	}
 
 	struct SliderCom
@@ -766,6 +1029,58 @@ namespace ui
 			trackTexture(trackTexture), layerDepth(layerDepth), value(value), pressCount(0.0f), hoverCount(0.0f), press(false), scale(scale)
 		{}
 	};
+}
+
+namespace ecs
+{
+	//·дֶд
+	template<>
+	struct Serializer<ui::SliderCom>
+	{
+		static constexpr bool enabled = true;
+		static constexpr const char* name = "ui::SliderCom";
+		static void write(BinaryWriter& out, const ui::SliderCom& slider)
+		{
+			out.write(slider.value);
+			out.write(slider.length);
+			out.write(slider.scale);
+			out.write(slider.pressCount);
+			out.write(slider.hoverCount);
+			out.write(slider.press);
+			out.write(slider.graduation);
+			out.write(slider.layerDepth);
+			out.write(slider.pos);
+			out.write(slider.trackColor);
+			out.write(slider.thumbColor);
+			Serializer<rlRAII::Texture2DRAII>::write(out, slider.thumbTexture);
+			Serializer<rlRAII::Texture2DRAII>::write(out, slider.trackTexture);
+		}
+		static ui::SliderCom read(BinaryReader& in)
+		{
+			const float value = in.read<float>();
+			const float length = in.read<float>();
+			const float scale = in.read<float>();
+			const float pressCount = in.read<float>();
+			const float hoverCount = in.read<float>();
+			const bool press = in.read<bool>();
+			const int graduation = in.read<int>();
+			const int layerDepth = in.read<int>();
+			const Vector2 pos = in.read<Vector2>();
+			const Color trackColor = in.read<Color>();
+			const Color thumbColor = in.read<Color>();
+			rlRAII::Texture2DRAII thumbTexture = Serializer<rlRAII::Texture2DRAII>::read(in);
+			rlRAII::Texture2DRAII trackTexture = Serializer<rlRAII::Texture2DRAII>::read(in);
+			ui::SliderCom result(length, value, scale, graduation, pos, trackColor, thumbColor, std::move(thumbTexture), std::move(trackTexture), layerDepth);
+			result.pressCount = pressCount;
+			result.hoverCount = hoverCount;
+			result.press = press;
+			return result;
+		}
+	};
+}
+
+namespace ui
+{
 
 	class SliderDraw : public ecs::DrawBase
 	{
@@ -817,9 +1132,20 @@ namespace ui
 	private:
 		ecs::DoubleComs<SliderCom>* coms;
 		ecs::Layers* layers;
+		HitTestIndex* hits;
 
 	public:
-		SliderSystem(ecs::DoubleComs<SliderCom>* coms, ecs::Layers* layers) : coms(coms), layers(layers) {}
+		SliderSystem(ecs::DoubleComs<SliderCom>* coms, ecs::Layers* layers, HitTestIndex* hits) : coms(coms), layers(layers), hits(hits) {}
+
+		const char* name() const override
+		{
+			return "ui::SliderSystem";
+		}
+
+		ecs::SystemAccess access() const override
+		{
+			return ecs::SystemAccess::Shared().write(coms).write(layers).write(hits).input();
+		}
 
 		void update() override
 		{
@@ -827,54 +1153,65 @@ namespace ui
 			(
 				[this](ecs::entity id, SliderCom& comActive)
 				{
-					SliderCom& comInactive = *(coms->inactive()->get(id));
-
-					comInactive = comActive;
-
 					float deltaTime = GetFrameTime();
 					float halfL = comActive.length * 0.5f;
 					float delta = comActive.length / (comActive.graduation - 1);
 					Vector2 thumbPos = { comActive.pos.x - halfL + comActive.length * comActive.value, comActive.pos.y };
 
-					if (comActive.press && IsMouseButtonReleased(MOUSE_BUTTON_LEFT))
+					//ֻƻ仯ֶΣÿ֡
+					bool press = comActive.press;
+					float value = comActive.value;
+					float pressCount = comActive.pressCount;
+					float hoverCount = comActive.hoverCount;
+
+					if (comActive.press && hits->released())
 					{
-						comInactive.press = false;
+						press = false;
 					}
-					if (Vector2DistanceSqr(thumbPos, GetMousePosition()) > 225 * comActive.scale * comActive.scale)
+					hits->track(id, HitArea{ ecs::AABB(thumbPos, 15.0f * comActive.scale), true, comActive.layerDepth });//Ϊ
+					if (!hits->isHovered(id))
 					{
-						comInactive.hoverCount -= deltaTime * 6.0f;
-						comInactive.hoverCount = std::clamp(comInactive.hoverCount, 0.5f, 1.0f);
+						hoverCount -= deltaTime * 6.0f;
+						hoverCount = std::clamp(hoverCount, 0.5f, 1.0f);
 					}
 					else
 					{
-						comInactive.hoverCount += deltaTime * 6.0f;
-						comInactive.hoverCount = std::clamp(comInactive.hoverCount, 0.5f, 1.0f);
-						if (!comActive.press && IsMouseButtonPressed(MOUSE_BUTTON_LEFT))
+						hoverCount += deltaTime * 6.0f;
+						hoverCount = std::clamp(hoverCount, 0.5f, 1.0f);
+						if (!comActive.press && hits->pressed())
 						{
-							comInactive.press = true;
+							press = true;
 						}
 					}
 					if (comActive.press)
 					{
-						comInactive.pressCount += deltaTime * 20.0f;
-						comInactive.pressCount = std::clamp(comInactive.pressCount, 0.0f, 1.0f);
-						float x = GetMousePosition().x;
+						pressCount += deltaTime * 20.0f;
+						pressCount = std::clamp(pressCount, 0.0f, 1.0f);
+						float x = hits->mousePosition().x;
 						x = std::clamp(x, comActive.pos.x - halfL, comActive.pos.x + halfL);
 						x -= comActive.pos.x;
 						x += halfL;
 						if (comActive.graduation > 1)
 						{
-							comInactive.value = std::clamp(int(x / delta + 0.5f) / float(comActive.graduation - 1), 0.0f, 1.0f);
+							value = std::clamp(int(x / delta + 0.5f) / float(comActive.graduation - 1), 0.0f, 1.0f);
 						}
 						else
 						{
-							comInactive.value = x / comActive.length;
+							value = x / comActive.length;
 						}
 					}
 					else
 					{
-						comInactive.pressCount -= deltaTime * 20.0f;
-						comInactive.pressCount = std::clamp(comInactive.pressCount, 0.0f, 1.0f);
+						pressCount -= deltaTime * 20.0f;
+						pressCount = std::clamp(pressCount, 0.0f, 1.0f);
+					}
+					if (press != comActive.press || value != comActive.value || pressCount != comActive.pressCount || hoverCount != comActive.hoverCount)
+					{
+						SliderCom& comInactive = *(coms->inactive()->modify(id));
+						comInactive.press = press;
+						comInactive.value = value;
+						comInactive.pressCount = pressCount;
+						comInactive.hoverCount = hoverCount;
 					}
 					(*layers)[comActive.layerDepth].push_back(std::make_unique<SliderDraw>(SliderDraw(comActive, halfL, delta)));
 				}
@@ -885,6 +1222,7 @@ namespace ui
 	void ApplySlider(ecs::World2D& world)
 	{
 		world.addPool<SliderCom>();
-		world.addSystem(SliderSystem(world.getDoubleBuffer<SliderCom>(), world.getUiLayer()));
+		HitTestIndex* hits = HitTestOf(world);
+		world.addSystem(SliderSystem(world.getDoubleBuffer<SliderCom>(), world.getUiLayer(), hits));
 	}
 }
\ No newline at end of file
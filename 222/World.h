@@ -8,23 +8,82 @@ namespace ecs
 {
 	using Layers = std::array<std::vector<std::unique_ptr<DrawBase>>, 16>;
 
+	using PrefabId = size_t;
+	constexpr PrefabId NULL_PREFAB = SIZE_MAX;
+
+	//ļ·дգȡʱԴͬ·ǴļصָΪ
+	template<>
+	struct Serializer<rlRAII::TextureRAII>
+	{
+		static constexpr bool enabled = true;
+		static constexpr const char* name = "rlRAII::TextureRAII";
+		static void write(BinaryWriter& out, const rlRAII::TextureRAII& texture)
+		{
+			const char* path = texture.path();
+			out.writeString(path == nullptr ? std::string() : std::string(path));
+		}
+		static rlRAII::TextureRAII read(BinaryReader& in)
+		{
+			const std::string path = in.readString();
+			return path.empty() ? rlRAII::TextureRAII() : rlRAII::TextureRAII::Acquire(path);
+		}
+	};
+
 	class World2D
 	{
 	private:
 		int screenX;
 		int screenY;
 		IdManager entityManager;
-		std::unordered_map<std::type_index, std::unique_ptr<ComponentPoolBase>> comPools0;
-		std::unordered_map<std::type_index, std::unique_ptr<ComponentPoolBase>> comPools1;
-		std::unordered_map<std::type_index, std::unique_ptr<DoubleBufferedBase>> doubleBuffered;
+		//ComponentTypeIdΪ±꣬δעΪ
+		std::vector<std::unique_ptr<ComponentPoolBase>> comPools0;
+		std::vector<std::unique_ptr<ComponentPoolBase>> comPools1;
+		std::vector<std::unique_ptr<DoubleBufferedBase>> doubleBuffered;
+		std::vector<size_t> poolIds;//עͱţע˳
 
 		std::vector<std::unique_ptr<SystemBase>> systems;
+		std::vector<size_t> systemTypes;//systemsһһӦSystemTypeId
+		std::vector<SystemBase*> systemSlots;//SystemTypeIdΪ±꣬ͬжʵʱָע
+		std::vector<Task> pendingSystemChanges;//ϵͳִڼɾ滻ִϺύ˳Ӧ
+		std::mutex systemChangeMtx;//ͬ㲢еϵͳͬʱύ
+		std::atomic<bool> runningSystems = false;//߳ϵϵͳͨchangeSystemsȡ
 		std::array<std::vector<std::unique_ptr<DrawBase>>, 16> unitsLayer;
 		std::array<std::vector<std::unique_ptr<DrawBase>>, 16> uiLayer;
 		MessageManager messageManager;
 		Camera2D camera;
 		
-		std::vector<entity> waitDelete;
+		SignatureTable signatures;//ؼʱд룬κ;¼
+		std::vector<std::pair<entity, Signature>> waitDelete;//ɾʱǩupdateǰʵ帴
+		std::mutex deleteMtx;//ͬ㲢еϵͳͬʱɾʵ
+		std::vector<std::vector<entity>> deleteBuckets;//ComponentTypeIdͰĴɾʵ
+
+		//ԤƼѹõϣʵʱֵƣRAIIֻü
+		class PrefabBase
+		{
+		public:
+			virtual ~PrefabBase() = default;
+			virtual void instantiate(World2D& world, entity id) const = 0;
+		};
+		template<typename ...Ts>
+		class Prefab : public PrefabBase
+		{
+		private:
+			std::tuple<Ts...> coms;
+		public:
+			Prefab(Ts&&...coms) : coms(std::move(coms)...) {}
+			void instantiate(World2D& world, entity id) const override
+			{
+				std::apply([&world, id](const Ts&...c) { world.createUnit(id, c...); }, coms);
+			}
+		};
+		std::vector<std::unique_ptr<PrefabBase>> prefabs;
+
+		ThreadPool* threadPool = nullptr;
+		std::vector<SystemAccess> accesses;
+		std::vector<size_t> systemLevel;
+		std::vector<std::vector<size_t>> schedule;//ÿһɲִеϵͳ±
+		bool scheduleDirty = true;//ϵͳб仯λһִ֡ǰ·ֲ
+		bool scheduleDump = false;
 
 		rlRAII::RenderTexture2DRAII renderTexture0;
 		rlRAII::RenderTexture2DRAII renderTexture1;
@@ -41,29 +100,212 @@ namespace ecs
 		template<typename T>
 		ComponentPool<T>* getPool0()
 		{
-			auto it = comPools0.find(std::type_index(typeid(T)));
-			if (it != comPools0.end())
+			const size_t id = ComponentTypeId<T>();
+			return id < comPools0.size() ? static_cast<ComponentPool<T>*>(comPools0[id].get()) : nullptr;
+		}
+		template<typename T>
+		ComponentPool<T>* getPool1()
+		{
+			const size_t id = ComponentTypeId<T>();
+			return id < comPools1.size() ? static_cast<ComponentPool<T>*>(comPools1[id].get()) : nullptr;
+		}
+		//˳Ϊϵͳֲ㣺ǰһϵͳͻϵͳ֮һ㣬ͬϵͳͻ
+		//ֻϵͳб仯ؽϵͳķڼΪ
+		void buildSchedule()
+		{
+			scheduleDirty = false;
+			accesses.clear();
+			systemLevel.assign(systems.size(), 0);
+			for (auto& layer : schedule)
 			{
-				return static_cast<ComponentPool<T>*>((it->second).get());
+				layer.clear();
 			}
-			else
+			size_t levels = 0;
+			for (size_t i = 0; i < systems.size(); ++i)
+			{
+				accesses.push_back(systems[i]->access());
+				size_t level = 0;
+				for (size_t j = 0; j < i; ++j)
+				{
+					if (systemLevel[j] >= level && accesses[i].conflicts(accesses[j]))
+					{
+						level = systemLevel[j] + 1;
+					}
+				}
+				systemLevel[i] = level;
+				levels = std::max(levels, level + 1);
+			}
+			if (schedule.size() < levels)
+			{
+				schedule.resize(levels);
+			}
+			for (size_t i = 0; i < systems.size(); ++i)
+			{
+				schedule[systemLevel[i]].push_back(i);
+			}
+			while (!schedule.empty() && schedule.back().empty())
 			{
-				return nullptr;
+				schedule.pop_back();
 			}
 		}
-		template<typename T>
-		ComponentPool<T>* getPool1()
+		//ϵͳ͵Ϣϵͳ±Եݴϲ˳̵߳޹
+		void runSystem(const size_t i)
+		{
+			MessageProducerScope producer(i);
+			systems[i]->update();
+		}
+		void runSystems()
+		{
+			if (scheduleDirty)
+			{
+				buildSchedule();
+			}
+			if (scheduleDump)
+			{
+				TraceLog(LOG_INFO, "%s", dumpSchedule().c_str());
+			}
+			for (auto& layer : schedule)
+			{
+				if (threadPool == nullptr || layer.size() == 1)
+				{
+					for (auto i : layer)
+					{
+						runSystem(i);
+					}
+					continue;
+				}
+				WaitGroup wg;
+				for (size_t k = 1; k < layer.size(); ++k)
+				{
+					threadPool->submit(wg, [this, i = layer[k]]() { runSystem(i); });
+				}
+				runSystem(layer[0]);
+				threadPool->wait(wg);
+			}
+		}
+		void insertSystem(const size_t type, std::unique_ptr<SystemBase> sys)
+		{
+			if (type >= systemSlots.size())
+			{
+				systemSlots.resize(type + 1, nullptr);
+			}
+			if (systemSlots[type] == nullptr)
+			{
+				systemSlots[type] = sys.get();
+			}
+			systems.push_back(std::move(sys));
+			systemTypes.push_back(type);
+			scheduleDirty = true;
+		}
+		void eraseSystem(const size_t type)
+		{
+			auto it = std::find(systemTypes.begin(), systemTypes.end(), type);
+			if (it == systemTypes.end())
+			{
+				return;
+			}
+			const size_t i = it - systemTypes.begin();
+			systems.erase(systems.begin() + i);
+			systemTypes.erase(it);
+			scheduleDirty = true;
+			auto next = std::find(systemTypes.begin(), systemTypes.end(), type);
+			systemSlots[type] = next == systemTypes.end() ? nullptr : systems[next - systemTypes.begin()].get();
+		}
+		void placeSystem(const size_t type, std::unique_ptr<SystemBase> sys)//滻ͬ͵ĵһʵִ˳򣬲׷
 		{
-			auto it = comPools1.find(std::type_index(typeid(T)));
-			if (it != comPools1.end())
+			auto it = std::find(systemTypes.begin(), systemTypes.end(), type);
+			if (it == systemTypes.end())
 			{
-				return static_cast<ComponentPool<T>*>((it->second).get());
+				insertSystem(type, std::move(sys));
+				return;
+			}
+			std::unique_ptr<SystemBase>& slot = systems[it - systemTypes.begin()];
+			slot = std::move(sys);
+			systemSlots[type] = slot.get();
+			scheduleDirty = true;
+		}
+		template<typename Func>
+		void changeSystems(Func&& change)
+		{
+			if (runningSystems)
+			{
+				std::lock_guard<std::mutex> lockChanges(systemChangeMtx);
+				pendingSystemChanges.emplace_back(std::forward<Func>(change));
 			}
 			else
 			{
-				return nullptr;
+				change();
+			}
+		}
+		//ֻʵӵеɾÿһɾ֮֡ãӳٵsync
+		//ǩȡdeleteUnitʱʱеĲǰ߸ѱʵ帴õ
+		//߸deleteUnit֮žsyncͬһ֡ڴɾʵ壩
+		//ųMAX_COMPONENT_TYPES޷ǩЩվɾ
+		void removeDeleted()
+		{
+			if (waitDelete.empty())
+			{
+				return;
+			}
+			if (deleteBuckets.size() < doubleBuffered.size())
+			{
+				deleteBuckets.resize(doubleBuffered.size());
+			}
+			for (auto& [id, captured] : waitDelete)
+			{
+				const Signature components = captured | signatures.take(id);
+				for (size_t type : poolIds)
+				{
+					if (type >= MAX_COMPONENT_TYPES || components.test(type))
+					{
+						deleteBuckets[type].push_back(id);
+					}
+				}
+			}
+			for (size_t type : poolIds)
+			{
+				auto& bucket = deleteBuckets[type];
+				if (bucket.empty())
+				{
+					continue;
+				}
+				comPools0[type]->removeBatch(bucket.data(), bucket.size());
+				comPools1[type]->removeBatch(bucket.data(), bucket.size());
+				bucket.clear();
 			}
+			waitDelete.clear();
+		}
+		template<typename T, typename It0, typename It1>
+		void createUnitsOf(const std::vector<entity>& ids, It0 first0, It1 first1)
+		{
+			getPool0<T>()->addBatch(ids.data(), first0, ids.size());
+			getPool1<T>()->addBatch(ids.data(), first1, ids.size());
+		}
+		template<typename T>
+		ComponentPool<T>* activePool()
+		{
+			auto buffer = getDoubleBuffer<T>();
+			return buffer == nullptr ? nullptr : buffer->active();
 		}
+		void rebuildSignatures()
+		{
+			signatures.clear();
+			for (size_t type : poolIds)
+			{
+				if (type >= MAX_COMPONENT_TYPES)
+				{
+					continue;
+				}
+				for (auto* pool : { comPools0[type].get(), comPools1[type].get() })
+				{
+					const std::vector<entity>& ids = pool->entities();
+					signatures.set(ids.data(), ids.size(), type);
+				}
+			}
+		}
+
+		static constexpr uint32_t SNAPSHOT_MAGIC = 0x53574E56;//"VNWS"
+		static constexpr uint32_t SNAPSHOT_VERSION = 1;
 	public:
 		uint64_t framesCount = 0;
 
@@ -84,59 +326,277 @@ namespace ecs
 		template<typename T>
 		World2D& addPool()
 		{
-			comPools0.emplace(std::type_index(typeid(T)), std::unique_ptr<ComponentPoolBase>(new ComponentPool<T>));
-			comPools1.emplace(std::type_index(typeid(T)), std::unique_ptr<ComponentPoolBase>(new ComponentPool<T>));
-			doubleBuffered.emplace(std::type_index(typeid(T)), std::unique_ptr<DoubleBufferedBase>(new DoubleBuffered<ComponentPool<T>*>(getPool0<T>(), getPool1<T>(), framesCount % 2 == 0)));
+			const size_t id = ComponentTypeId<T>();
+			if (id >= doubleBuffered.size())
+			{
+				comPools0.resize(id + 1);
+				comPools1.resize(id + 1);
+				doubleBuffered.resize(id + 1);
+			}
+			if (doubleBuffered[id])
+			{
+				return *this;
+			}
+			comPools0[id].reset(new ComponentPool<T>);
+			comPools1[id].reset(new ComponentPool<T>);
+			comPools0[id]->trackSignatures(&signatures, id);
+			comPools1[id]->trackSignatures(&signatures, id);
+			doubleBuffered[id].reset(new DoubleBuffered<ComponentPool<T>*>(getPool0<T>(), getPool1<T>(), framesCount % 2 == 0));
+			poolIds.push_back(id);
 			return *this;
 		}
 		template<typename T>
 		DoubleBuffered<ComponentPool<T>*>* getDoubleBuffer()
 		{
-			auto it = doubleBuffered.find(std::type_index(typeid(T)));
-			if (it == doubleBuffered.end())
-			{
-				return nullptr;
-			}
-			else
-			{
-				return static_cast<DoubleBuffered<ComponentPool<T>*>*>(it->second.get());
-			}
+			const size_t id = ComponentTypeId<T>();
+			return id < doubleBuffered.size() ? static_cast<DoubleBuffered<ComponentPool<T>*>*>(doubleBuffered[id].get()) : nullptr;
+		}
+		template<typename ...Ts>
+		View<Ts...> view()//ԾϵĶͼ
+		{
+			return View<Ts...>(activePool<Ts>()...);
 		}
+		//ϵͳִڼõaddSystem/removeSystem/replaceSystemڱ֡ϵͳȫִЧ
 		template<typename T>
 		World2D& addSystem(T&& sys)
 		{
-			systems.push_back(std::make_unique<std::decay_t<T>>(std::forward<T>(sys)));
+			using S = std::decay_t<T>;
+			changeSystems([this, sys = std::make_unique<S>(std::forward<T>(sys))]() mutable { insertSystem(SystemTypeId<S>(), std::move(sys)); });
+			return *this;
+		}
+		template<typename T>
+		World2D& removeSystem()//Ƴעʵ
+		{
+			changeSystems([this]() { eraseSystem(SystemTypeId<T>()); });
 			return *this;
 		}
 		template<typename T>
+		World2D& replaceSystem(T&& sys)
+		{
+			using S = std::decay_t<T>;
+			changeSystems([this, sys = std::make_unique<S>(std::forward<T>(sys))]() mutable { placeSystem(SystemTypeId<S>(), std::move(sys)); });
+			return *this;
+		}
+		//ȷͲңƥ
+		template<typename T>
 		T* getSystem()
 		{
-			for (auto& s : systems)
+			const size_t id = SystemTypeId<T>();
+			return id < systemSlots.size() ? static_cast<T*>(systemSlots[id]) : nullptr;
+		}
+		void setThreadPool(ThreadPool* tp)//ú޳ͻϵͳ̳߳ϲִУnullptrȫ
+		{
+			threadPool = tp;
+		}
+		void setScheduleDump(bool enable)//ÿ֡ͨTraceLogϵͳֲ
+		{
+			scheduleDump = enable;
+		}
+		const std::vector<std::vector<size_t>>& getSchedule() const
+		{
+			return schedule;
+		}
+		std::string dumpSchedule() const
+		{
+			std::string result = "frame " + std::to_string(framesCount) + ":";
+			for (auto& layer : schedule)
 			{
-				T* result = dynamic_cast<T*>(s.get());
-				if (result != nullptr)
+				result += " [";
+				for (size_t k = 0; k < layer.size(); ++k)
 				{
-					return result;
+					if (k > 0)
+					{
+						result += " | ";
+					}
+					const char* name = systems[layer[k]]->name();
+					result += name != nullptr ? std::string(name) : "system#" + std::to_string(systemTypes[layer[k]]);
 				}
+				result += "]";
 			}
-			return nullptr;
+			return result;
+		}
+		std::vector<PoolStats> getPoolStats() const//صڴռһ֡ͬ
+		{
+			std::vector<PoolStats> result;
+			for (size_t id : poolIds)
+			{
+				result.push_back(doubleBuffered[id]->stats());
+			}
+			return result;
 		}
 		rlRAII::RenderTexture2DRAII& getSceenshot()
 		{
 			return inactiveRenderTexture();
 		}
+		//ϵͳִڼʱشӳģʽڱ֡updateʱż룬֡getʵ巵nullptr
 		template<typename T, typename...Args>
 		World2D& createUnit(entity id, T com, Args...args)
 		{
 			getPool0<std::decay_t<T>>()->add(id, com);
-			getPool1<std::decay_t<T>>()->add(id, com);
+			getPool1<std::decay_t<T>>()->add(id, std::move(com));
 			createUnit(id, args...);
 			return *this;
 		}
 		inline void createUnit(entity id) noexcept {}
-		void deleteUnit(entity id)
+		//ͬʵ壺ÿΪһidsȳ飬ÿֻһ
+		//Ȳһʱκʵ
+		template<typename...Ts>
+		World2D& createUnits(const std::vector<entity>& ids, const std::vector<Ts>&...coms)
+		{
+			if (((coms.size() != ids.size()) || ...))
+			{
+				return *this;
+			}
+			(createUnitsOf<Ts>(ids, coms.begin(), coms.begin()), ...);
+			return *this;
+		}
+		//ֵ汾һ帴ƣһֱ
+		template<typename...Ts>
+		World2D& createUnits(const std::vector<entity>& ids, std::vector<Ts>&&...coms)
+		{
+			if (((coms.size() != ids.size()) || ...))
+			{
+				return *this;
+			}
+			(createUnitsOf<Ts>(ids, coms.begin(), std::make_move_iterator(coms.begin())), ...);
+			return *this;
+		}
+		//עʱԴأ֮ʵκԴ
+		template<typename...Ts>
+		PrefabId registerPrefab(Ts...coms)
+		{
+			prefabs.push_back(std::make_unique<Prefab<Ts...>>(std::move(coms)...));
+			return prefabs.size() - 1;
+		}
+		World2D& instantiate(PrefabId prefab, entity id)
+		{
+			if (prefab < prefabs.size())
+			{
+				prefabs[prefab]->instantiate(*this, id);
+			}
+			return *this;
+		}
+		bool hasPrefab(PrefabId prefab) const
+		{
+			return prefab < prefabs.size();
+		}
+		//գʵšлδĿлϢ֮֡
+		//Ƴɾʵ壻лءϵͳԤƼڿ
+		std::vector<uint8_t> saveSnapshot()
 		{
-			waitDelete.push_back(id);
+			removeDeleted();
+			BinaryWriter out;
+			out.write(SNAPSHOT_MAGIC);
+			out.write(SNAPSHOT_VERSION);
+			entityManager.save(out);
+			const size_t countOffset = out.reserveU64();
+			uint64_t count = 0;
+			for (size_t id : poolIds)
+			{
+				const uint64_t key = doubleBuffered[id]->serialKey();
+				if (key == 0)
+				{
+					continue;
+				}
+				out.write(key);
+				const size_t length = out.reserveU64();
+				out.align();
+				const size_t begin = out.size();
+				doubleBuffered[id]->save(out);
+				out.patchU64(length, out.size() - begin);
+				++count;
+			}
+			out.patchU64(countOffset, count);
+			messageManager.save(out);
+			return std::move(out.data());
+		}
+		bool saveSnapshot(const char* path)
+		{
+			return WriteFileBytes(path, saveSnapshot());
+		}
+		//е滻Ӧĳأûеĳرֲ䣬δעĳصݱ
+		//PODֱӴdata鸴ƣȰս뵽ݴȫɹ滻ʧʱfalse粻
+		bool loadSnapshot(const uint8_t* data, const size_t size)
+		{
+			std::vector<uint8_t> aligned;
+			if (reinterpret_cast<uintptr_t>(data) % SNAPSHOT_ALIGN != 0)
+			{
+				aligned.assign(data, data + size);
+				data = aligned.data();
+			}
+			BinaryReader in(data, size);
+			if (in.read<uint32_t>() != SNAPSHOT_MAGIC || in.read<uint32_t>() != SNAPSHOT_VERSION)
+			{
+				return false;
+			}
+			IdManager ids;
+			if (!ids.load(in))
+			{
+				return false;
+			}
+			std::unordered_map<uint64_t, size_t> keyToPool;
+			for (size_t id : poolIds)
+			{
+				const uint64_t key = doubleBuffered[id]->serialKey();
+				if (key != 0)
+				{
+					keyToPool.emplace(key, id);
+				}
+			}
+			std::vector<size_t> staged;
+			bool result = true;
+			const uint64_t count = in.read<uint64_t>();
+			for (uint64_t i = 0; result && i < count && in.ok(); ++i)
+			{
+				const uint64_t key = in.read<uint64_t>();
+				const uint64_t length = in.read<uint64_t>();
+				in.align();
+				const size_t end = in.offset() + size_t(length);
+				auto it = keyToPool.find(key);
+				if (it != keyToPool.end())
+				{
+					staged.push_back(it->second);
+					result = doubleBuffered[it->second]->stageLoad(in);
+				}
+				result = result && in.offset() <= end;
+				if (result)
+				{
+					in.skip(end - in.offset());
+				}
+			}
+			//ϢĶȡҪôȫЧҪô䣬֮滻ʧ
+			if (!result || !in.ok() || !messageManager.load(in))
+			{
+				for (size_t id : staged)
+				{
+					doubleBuffered[id]->discardLoad();
+				}
+				return false;
+			}
+			waitDelete.clear();
+			entityManager = std::move(ids);
+			for (size_t id : staged)
+			{
+				doubleBuffered[id]->commitLoad();
+			}
+			rebuildSignatures();
+			return true;
+		}
+		//ͨڴӳȡļ
+		bool loadSnapshot(const char* path)
+		{
+			MappedFile file(path);
+			return file.valid() && loadSnapshot(file.data(), file.size());
+		}
+		void deleteUnit(entity id)//ϵͳвеãһupdateʼʱƳ
+		{
+			const Signature components = signatures.take(id);
+			std::lock_guard<std::mutex> lockDelete(deleteMtx);
+			waitDelete.emplace_back(id, components);
+		}
+		Signature getSignature(entity id) const
+		{
+			return signatures.get(id);
 		}
 		void draw()
 		{
@@ -172,26 +632,29 @@ namespace ecs
 		}
 		void update()
 		{
-			for (auto i : waitDelete)
+			removeDeleted();
+			messageManager.sendAll();
+			for (size_t id : poolIds)
 			{
-				for (auto& ps : comPools0)
-				{
-					ps.second->remove(i);
-				}
-				for (auto& ps : comPools1)
-				{
-					ps.second->remove(i);
-				}
+				comPools0[id]->beginDeferred();
+				comPools1[id]->beginDeferred();
 			}
-			waitDelete.clear();
-			messageManager.sendAll();
-			for (auto& s : systems)
+			runningSystems = true;
+			runSystems();
+			runningSystems = false;
+			for (auto& change : pendingSystemChanges)
+			{
+				change();
+			}
+			pendingSystemChanges.clear();
+			for (size_t id : poolIds)
 			{
-				s->update();
+				comPools0[id]->sync();
+				comPools1[id]->sync();
 			}
-			for (auto& b : doubleBuffered)
+			for (size_t id : poolIds)
 			{
-				b.second->swap();
+				doubleBuffered[id]->swap();
 			}
 			messageManager.swap();
 			++framesCount;
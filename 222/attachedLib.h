@@ -3,8 +3,8 @@
 #include <string>
 inline uint64_t strHash(const std::string& str)
 {
-	constexpr uint64_t offset_basis = 0xCBF29CE484222325ui64;
-	constexpr uint64_t prime = 0x100000001B3ui64;
+	constexpr uint64_t offset_basis = 0xCBF29CE484222325ull;
+	constexpr uint64_t prime = 0x100000001B3ull;
 
 	uint64_t hash = offset_basis;
 	for (auto it = str.begin(); it != str.end(); it++)
@@ -17,57 +17,280 @@ inline uint64_t strHash(const std::string& str)
 
 #include <thread>
 #include <vector>
-#include <queue>
+#include <deque>
 #include <functional>
 #include <mutex>
 #include <future>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <new>
+#include <cstddef>
+#include <type_traits>
 
+//ͲĿɵöС洢ֻ֧ƶstd::function
+class Task
+{
+private:
+	static constexpr size_t INLINE_SIZE = 6 * sizeof(void*);
+
+	struct Ops
+	{
+		void (*invoke)(void* self);
+		void (*relocate)(void* dst, void* src);
+		void (*destroy)(void* self);
+	};
+
+	template<typename F>
+	static const Ops* inlineOps()
+	{
+		static const Ops ops =
+		{
+			[](void* self) { (*static_cast<F*>(self))(); },
+			[](void* dst, void* src) { new(dst) F(std::move(*static_cast<F*>(src))); static_cast<F*>(src)->~F(); },
+			[](void* self) { static_cast<F*>(self)->~F(); }
+		};
+		return &ops;
+	}
+	template<typename F>
+	static const Ops* heapOps()
+	{
+		static const Ops ops =
+		{
+			[](void* self) { (**static_cast<F**>(self))(); },
+			[](void* dst, void* src) { *static_cast<F**>(dst) = *static_cast<F**>(src); },
+			[](void* self) { delete *static_cast<F**>(self); }
+		};
+		return &ops;
+	}
+
+	alignas(std::max_align_t) unsigned char storage[INLINE_SIZE];
+	const Ops* ops = nullptr;
+
+public:
+	Task() = default;
+
+	template<typename Func, typename = std::enable_if_t<!std::is_same_v<std::decay_t<Func>, Task>>>
+	Task(Func&& func)
+	{
+		using F = std::decay_t<Func>;
+		if constexpr (sizeof(F) <= INLINE_SIZE && alignof(F) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible_v<F>)
+		{
+			new(storage) F(std::forward<Func>(func));
+			ops = inlineOps<F>();
+		}
+		else
+		{
+			*reinterpret_cast<F**>(storage) = new F(std::forward<Func>(func));
+			ops = heapOps<F>();
+		}
+	}
+	Task(Task&& other) noexcept : ops(other.ops)
+	{
+		if (ops)
+		{
+			ops->relocate(storage, other.storage);
+			other.ops = nullptr;
+		}
+	}
+	Task& operator=(Task&& other) noexcept
+	{
+		if (&other == this)
+		{
+			return *this;
+		}
+		if (ops)
+		{
+			ops->destroy(storage);
+		}
+		ops = other.ops;
+		if (ops)
+		{
+			ops->relocate(storage, other.storage);
+			other.ops = nullptr;
+		}
+		return *this;
+	}
+	Task(const Task&) = delete;
+	Task& operator=(const Task&) = delete;
+	~Task()
+	{
+		if (ops)
+		{
+			ops->destroy(storage);
+		}
+	}
+
+	void operator()()
+	{
+		ops->invoke(storage);
+	}
+	explicit operator bool() const
+	{
+		return ops != nullptr;
+	}
+};
+
+//һɼȴڼǰִ
+class WaitGroup
+{
+private:
+	std::atomic<size_t> count;
+
+public:
+	WaitGroup() : count(0) {}
+	WaitGroup(const WaitGroup&) = delete;
+	WaitGroup& operator=(const WaitGroup&) = delete;
+
+	void add(size_t n = 1)
+	{
+		count.fetch_add(n, std::memory_order_acq_rel);
+	}
+	void done()
+	{
+		count.fetch_sub(1, std::memory_order_acq_rel);
+	}
+	bool finished() const
+	{
+		return count.load(std::memory_order_acquire) == 0;
+	}
+};
+
+//ȡ̳߳أÿ߳һ˫˶У̴߳βȡ(LIFO)̴߳ͷȡ(FIFO)
 class ThreadPool
 {
 private:
+	struct WorkQueue
+	{
+		std::mutex mtx;
+		std::deque<Task> tasks;
+	};
+
 	size_t size;
-	bool stop;
+	std::atomic<bool> stop;
 
 	std::vector<std::thread> workers;
-	std::queue<std::function<void()>> tasks;
+	std::vector<std::unique_ptr<WorkQueue>> queues;
 
-	std::condition_variable condition;
-	std::condition_variable waitCondition;
-	std::mutex threadMutex;
+	std::atomic<size_t> pending;//δȡߵ
+	std::atomic<size_t> unfinished;//δִ
+	std::atomic<size_t> sleepers;
+	std::atomic<size_t> nextQueue;
 
-	std::atomic<size_t> activeCount;
+	std::mutex sleepMutex;
+	std::condition_variable condition;
 
-public:
+	static ThreadPool*& currentPool()
+	{
+		thread_local ThreadPool* pool = nullptr;
+		return pool;
+	}
+	static size_t& currentIndex()
+	{
+		thread_local size_t index = SIZE_MAX;
+		return index;
+	}
+	size_t selfIndex() const
+	{
+		return currentPool() == this ? currentIndex() : SIZE_MAX;
+	}
 
-	ThreadPool(size_t size = std::max(std::thread::hardware_concurrency(), unsigned int(1))) : size(size), stop(false), activeCount(0)
+	void push(Task&& task)
 	{
+		size_t index = selfIndex();
+		if (index == SIZE_MAX)
+		{
+			index = nextQueue.fetch_add(1, std::memory_order_relaxed) % size;
+		}
+		unfinished.fetch_add(1);
+		{
+			std::lock_guard lock(queues[index]->mtx);
+			queues[index]->tasks.push_back(std::move(task));
+		}
+		pending.fetch_add(1);
+		if (sleepers.load() > 0)
+		{
+			{
+				std::lock_guard lock(sleepMutex);
+			}
+			condition.notify_one();
+		}
+	}
+	bool pop(size_t index, Task& task)
+	{
+		if (index != SIZE_MAX)
+		{
+			std::lock_guard lock(queues[index]->mtx);
+			if (!queues[index]->tasks.empty())
+			{
+				task = std::move(queues[index]->tasks.back());
+				queues[index]->tasks.pop_back();
+				pending.fetch_sub(1);
+				return true;
+			}
+		}
+		const size_t start = index == SIZE_MAX ? 0 : index + 1;
 		for (size_t i = 0; i < size; i++)
 		{
-			workers.push_back(std::thread([this]()
+			WorkQueue& victim = *queues[(start + i) % size];
+			std::unique_lock lock(victim.mtx, std::try_to_lock);
+			if (lock.owns_lock() && !victim.tasks.empty())
+			{
+				task = std::move(victim.tasks.front());
+				victim.tasks.pop_front();
+				pending.fetch_sub(1);
+				return true;
+			}
+		}
+		return false;
+	}
+	void run(Task& task)
+	{
+		task();
+		task = Task();
+		unfinished.fetch_sub(1, std::memory_order_acq_rel);
+	}
+
+	template<typename Func>
+	void parallelForImpl(size_t begin, size_t end, size_t grain, const Func& func, WaitGroup& wg)
+	{
+		while (end - begin > grain)
+		{
+			const size_t mid = begin + (end - begin) / 2;
+			submit(wg, [this, mid, end, grain, &func, &wg]() { parallelForImpl(mid, end, grain, func, wg); });
+			end = mid;
+		}
+		func(begin, end);
+	}
+
+public:
+	ThreadPool(size_t size = std::max(std::thread::hardware_concurrency(), 1u)) : size(std::max<size_t>(size, 1)), stop(false), pending(0), unfinished(0), sleepers(0), nextQueue(0)
+	{
+		for (size_t i = 0; i < this->size; i++)
+		{
+			queues.push_back(std::make_unique<WorkQueue>());
+		}
+		for (size_t i = 0; i < this->size; i++)
+		{
+			workers.push_back(std::thread([this, i]()
 				{
+					currentPool() = this;
+					currentIndex() = i;
 					while (true)
 					{
-						std::function<void()> task;
+						Task task;
+						if (pop(i, task))
 						{
-							std::unique_lock lock(threadMutex);
-
-							condition.wait(lock, [this]() {return stop || !tasks.empty(); });
-							if (stop && tasks.empty())
-							{
-								return;
-							}
-							task = std::move(tasks.front());
-							tasks.pop();
+							run(task);
+							continue;
 						}
-						++activeCount;
-						task();
-						--activeCount;
+						std::unique_lock lock(sleepMutex);
+						sleepers.fetch_add(1);
+						condition.wait(lock, [this]() { return stop.load() || pending.load() > 0; });
+						sleepers.fetch_sub(1);
+						if (stop.load() && pending.load() == 0)
 						{
-							std::lock_guard lock(threadMutex);
-							if (activeCount == 0 && tasks.empty())
-							{
-								waitCondition.notify_all();
-							}
+							return;
 						}
 					}
 				}));
@@ -76,7 +299,7 @@ public:
 	~ThreadPool()
 	{
 		{
-			std::lock_guard lock(threadMutex);
+			std::lock_guard lock(sleepMutex);
 			stop = true;
 		}
 		condition.notify_all();
@@ -86,34 +309,119 @@ public:
 			}
 		}
 	}
+
+	template<typename Func>
+	void submit(Func&& func)//ύҪֵ
+	{
+		push(Task(std::forward<Func>(func)));
+	}
+	template<typename Func>
+	void submit(WaitGroup& wg, Func&& func)//ύ񲢼wg
+	{
+		wg.add();
+		push(Task([&wg, func = std::forward<Func>(func)]() mutable
+			{
+				func();
+				wg.done();
+			}));
+	}
 	template<typename Func, typename ...Args>
 	auto enqueue(Func&& func, Args&& ...args) -> std::future<decltype(func(args...))>
 	{
 		using return_type = decltype(func(args...));
-		auto argsTuple = std::make_tuple(std::forward<Args>(args)...);
-
-		auto task = std::make_shared<std::packaged_task<return_type()>>(
+		std::packaged_task<return_type()> task(
 			[func = std::forward<Func>(func),
-			args_tuple = std::move(argsTuple)]() mutable
+			args_tuple = std::make_tuple(std::forward<Args>(args)...)]() mutable
 			{
 				return std::apply(func, args_tuple);
 			}
 		);
+		std::future<return_type> result = task.get_future();
+		push(Task(std::move(task)));
+		return result;
+	}
 
-		std::future<return_type> result = task->get_future();
+	bool runOne()//ڵǰִ߳һûʱfalse
+	{
+		Task task;
+		if (pop(selfIndex(), task))
+		{
+			run(task);
+			return true;
+		}
+		return false;
+	}
+	void wait(const WaitGroup& wg)//ȴwgеɣȴڼִ񣬿Ƕ׵
+	{
+		while (!wg.finished())
+		{
+			if (!runOne())
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
 
+	//[begin, end)пֱgraincall func(blockBegin, blockEnd)
+	template<typename Func>
+	void parallelFor(size_t begin, size_t end, size_t grain, const Func& func)
+	{
+		if (begin >= end)
 		{
-			std::lock_guard lock(threadMutex);
-			tasks.emplace([task]() { (*task)(); });
+			return;
 		}
-		condition.notify_one();
-		return result;
+		WaitGroup wg;
+		parallelForImpl(begin, end, std::max<size_t>(grain, 1), func, wg);
+		wait(wg);
+	}
+	//ִ񣬷ʱ߶
+	template<typename FuncA, typename FuncB>
+	void join(FuncA&& a, FuncB&& b)
+	{
+		WaitGroup wg;
+		submit(wg, std::forward<FuncB>(b));
+		a();
+		wait(wg);
+	}
+
+	size_t threadCount() const
+	{
+		return size;
 	}
-	void wait()
+	void wait()//ȴ̳߳ȫ
 	{
-		std::unique_lock lock(threadMutex);
+		while (unfinished.load(std::memory_order_acquire) > 0)
+		{
+			if (!runOne())
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+};
+
+#include <chrono>
+
+//ʱߣʱʼʱ
+class Stopwatch
+{
+private:
+	std::chrono::steady_clock::time_point begin;
 
-		waitCondition.wait(lock, [this]() {return activeCount == 0 && tasks.empty(); });
+public:
+	Stopwatch() : begin(std::chrono::steady_clock::now()) {}
+
+	void restart()
+	{
+		begin = std::chrono::steady_clock::now();
+	}
+	double seconds() const
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+	}
+	double milliseconds() const
+	{
+		return seconds() * 1000.0;
 	}
 };
 
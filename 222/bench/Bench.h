@@ -0,0 +1,351 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <malloc.h>
+extern "C"
+{
+	struct BenchProcessMemoryCounters
+	{
+		unsigned long cb;
+		unsigned long PageFaultCount;
+		size_t PeakWorkingSetSize;
+		size_t WorkingSetSize;
+		size_t QuotaPeakPagedPoolUsage;
+		size_t QuotaPagedPoolUsage;
+		size_t QuotaPeakNonPagedPoolUsage;
+		size_t QuotaNonPagedPoolUsage;
+		size_t PagefileUsage;
+		size_t PeakPagefileUsage;
+	};
+	__declspec(dllimport) void* __stdcall GetCurrentProcess();
+	__declspec(dllimport) int __stdcall K32GetProcessMemoryInfo(void*, BenchProcessMemoryCounters*, unsigned long);
+}
+#else
+#include <sys/resource.h>
+#endif
+
+namespace bench
+{
+	inline volatile uint64_t sink = 0;
+
+	template<typename T>
+	inline void Consume(const T& value)
+	{
+		sink = sink + uint64_t(value);
+	}
+
+	//滻ȫoperator new
+	inline std::atomic<uint64_t> allocCount{ 0 };
+	inline std::atomic<uint64_t> allocBytes{ 0 };
+
+	//Linux̵ķֵפڴ棬ʹÿķֵֻӳƽ̨Ϊķֵ
+	inline void ResetPeakRss()
+	{
+#ifdef __linux__
+		if (FILE* file = std::fopen("/proc/self/clear_refs", "w"))
+		{
+			std::fputs("5", file);
+			std::fclose(file);
+		}
+#endif
+	}
+	inline size_t PeakRssKiB()
+	{
+#if defined(_WIN32)
+		BenchProcessMemoryCounters counters{};
+		counters.cb = sizeof(counters);
+		return K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) ? counters.PeakWorkingSetSize / 1024 : 0;
+#else
+#ifdef __linux__
+		if (FILE* file = std::fopen("/proc/self/status", "r"))
+		{
+			char line[256];
+			size_t kib = 0;
+			while (std::fgets(line, sizeof(line), file))
+			{
+				if (std::strncmp(line, "VmHWM:", 6) == 0)
+				{
+					kib = size_t(std::strtoull(line + 6, nullptr, 10));
+					break;
+				}
+			}
+			std::fclose(file);
+			if (kib > 0)
+			{
+				return kib;
+			}
+		}
+#endif
+		rusage usage{};
+		getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+		return size_t(usage.ru_maxrss) / 1024;
+#else
+		return size_t(usage.ru_maxrss);
+#endif
+#endif
+	}
+
+	struct Result
+	{
+		std::string name;
+		size_t ops;
+		double seconds;
+		uint64_t allocs = 0;
+		uint64_t bytes = 0;
+		size_t peakRssKiB = 0;
+
+		double nsPerOp() const { return ops == 0 ? 0.0 : seconds * 1e9 / ops; }
+		double opsPerSecond() const { return seconds == 0.0 ? 0.0 : ops / seconds; }
+		double allocsPerOp() const { return ops == 0 ? 0.0 : double(allocs) / ops; }
+		double bytesPerOp() const { return ops == 0 ? 0.0 : double(bytes) / ops; }
+	};
+
+	struct Options
+	{
+		std::string filter;//ְֻô
+		std::string jsonPath;//ǿʱȫдJSON
+	};
+	inline Options options;
+	inline std::vector<Result> results;
+	inline size_t failedChecks = 0;
+
+	//--filter <Ӵ> --json <ļ>
+	inline void ParseArgs(int argc, char** argv)
+	{
+		for (int i = 1; i + 1 < argc; ++i)
+		{
+			if (std::strcmp(argv[i], "--filter") == 0)
+			{
+				options.filter = argv[++i];
+			}
+			else if (std::strcmp(argv[i], "--json") == 0)
+			{
+				options.jsonPath = argv[++i];
+			}
+		}
+	}
+	inline bool Selected(const std::string& name)
+	{
+		return options.filter.empty() || name.find(options.filter) != std::string::npos;
+	}
+
+	inline void Print(const Result& result)
+	{
+		std::printf("%-48s %12.2f ns/op %16.0f ops/s %10.3f allocs/op %10zu KiB peak\n",
+			result.name.c_str(), result.nsPerOp(), result.opsPerSecond(), result.allocsPerOp(), result.peakRssKiB);
+	}
+	//мʱҪڼʱ׼ݣֱӼ¼ͳƷ䣻ֵڴӵ÷һResetPeakRss
+	inline void Record(const std::string& name, size_t ops, double seconds)
+	{
+		if (!Selected(name))
+		{
+			return;
+		}
+		Result result{ name, ops, seconds };
+		result.peakRssKiB = PeakRssKiB();
+		Print(result);
+		results.push_back(result);
+	}
+
+	//ȷԼ飺ʱдJSONκһʧʱFinishط
+	inline void Check(const std::string& name, bool ok)
+	{
+		if (!Selected(name))
+		{
+			return;
+		}
+		std::printf("%-48s %s\n", name.c_str(), ok ? "ok" : "FAILED");
+		failedChecks += ok ? 0 : 1;
+	}
+
+	//ִfuncһΣfuncڲopsβͬʱͳڼĶѷֵֽפڴ
+	template<typename Func>
+	Result Run(const std::string& name, size_t ops, Func&& func)
+	{
+		if (!Selected(name))
+		{
+			return Result{ name, 0, 0.0 };
+		}
+		ResetPeakRss();
+		const uint64_t allocsBefore = allocCount.load(std::memory_order_relaxed);
+		const uint64_t bytesBefore = allocBytes.load(std::memory_order_relaxed);
+		auto begin = std::chrono::steady_clock::now();
+		func();
+		auto end = std::chrono::steady_clock::now();
+		Result result{ name, ops, std::chrono::duration<double>(end - begin).count() };
+		result.allocs = allocCount.load(std::memory_order_relaxed) - allocsBefore;
+		result.bytes = allocBytes.load(std::memory_order_relaxed) - bytesBefore;
+		result.peakRssKiB = PeakRssKiB();
+		Print(result);
+		results.push_back(result);
+		return result;
+	}
+
+	inline void WriteJsonString(FILE* file, const std::string& str)
+	{
+		std::fputc('"', file);
+		for (char c : str)
+		{
+			if (c == '"' || c == '\\')
+			{
+				std::fputc('\\', file);
+			}
+			std::fputc(c, file);
+		}
+		std::fputc('"', file);
+	}
+	inline bool WriteJson(const std::string& path, const char* suite)
+	{
+		FILE* file = std::fopen(path.c_str(), "w");
+		if (file == nullptr)
+		{
+			return false;
+		}
+		std::fprintf(file, "{\n  \"suite\": ");
+		WriteJsonString(file, suite);
+		std::fprintf(file, ",\n  \"results\": [\n");
+		for (size_t i = 0; i < results.size(); ++i)
+		{
+			const Result& r = results[i];
+			std::fprintf(file, "    {\"name\": ");
+			WriteJsonString(file, r.name);
+			std::fprintf(file, ", \"ops\": %zu, \"ns_per_op\": %.3f, \"allocs_per_op\": %.4f, \"bytes_per_op\": %.2f, \"peak_rss_kib\": %zu}%s\n",
+				r.ops, r.nsPerOp(), r.allocsPerOp(), r.bytesPerOp(), r.peakRssKiB, i + 1 < results.size() ? "," : "");
+		}
+		std::fprintf(file, "  ]\n}\n");
+		return std::fclose(file) == 0;
+	}
+	//mainǰãдJSONؽ˳
+	inline int Finish(const char* suite)
+	{
+		if (!options.jsonPath.empty() && !WriteJson(options.jsonPath, suite))
+		{
+			std::fprintf(stderr, "cannot write %s\n", options.jsonPath.c_str());
+			return 1;
+		}
+		if (failedChecks > 0)
+		{
+			std::fprintf(stderr, "%zu check(s) failed\n", failedChecks);
+			return 1;
+		}
+		return 0;
+	}
+
+	//˳ʵid˳ڸǲҿ
+	inline std::vector<uint64_t> ShuffledIds(size_t count, uint32_t seed = 42)
+	{
+		std::vector<uint64_t> ids(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			ids[i] = i;
+		}
+		std::shuffle(ids.begin(), ids.end(), std::mt19937(seed));
+		return ids;
+	}
+}
+
+//滻ȫoperator new/deleteͳƷ䣻滻inlineͷļֻһ뵥Ԫ
+//ͨ汾Сdeleteɶ滻nothrow汾Ĭת
+namespace bench
+{
+	inline void* Allocate(std::size_t size)
+	{
+		allocCount.fetch_add(1, std::memory_order_relaxed);
+		allocBytes.fetch_add(size, std::memory_order_relaxed);
+		if (void* p = std::malloc(size == 0 ? 1 : size))
+		{
+			return p;
+		}
+		throw std::bad_alloc();
+	}
+	inline void* AllocateAligned(std::size_t size, std::align_val_t alignment)
+	{
+		allocCount.fetch_add(1, std::memory_order_relaxed);
+		allocBytes.fetch_add(size, std::memory_order_relaxed);
+		const size_t align = size_t(alignment);
+#ifdef _WIN32
+		void* p = _aligned_malloc(size == 0 ? 1 : size, align);
+#else
+		void* p = std::aligned_alloc(align, (std::max<size_t>(size, 1) + align - 1) / align * align);
+#endif
+		if (p == nullptr)
+		{
+			throw std::bad_alloc();
+		}
+		return p;
+	}
+	inline void Release(void* p) noexcept
+	{
+		std::free(p);
+	}
+	inline void ReleaseAligned(void* p) noexcept
+	{
+#ifdef _WIN32
+		_aligned_free(p);
+#else
+		std::free(p);
+#endif
+	}
+}
+
+void* operator new(std::size_t size)
+{
+	return bench::Allocate(size);
+}
+void* operator new[](std::size_t size)
+{
+	return bench::Allocate(size);
+}
+void operator delete(void* p) noexcept
+{
+	bench::Release(p);
+}
+void operator delete[](void* p) noexcept
+{
+	bench::Release(p);
+}
+void operator delete(void* p, std::size_t) noexcept
+{
+	bench::Release(p);
+}
+void operator delete[](void* p, std::size_t) noexcept
+{
+	bench::Release(p);
+}
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	return bench::AllocateAligned(size, alignment);
+}
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+	return bench::AllocateAligned(size, alignment);
+}
+void operator delete(void* p, std::align_val_t) noexcept
+{
+	bench::ReleaseAligned(p);
+}
+void operator delete[](void* p, std::align_val_t) noexcept
+{
+	bench::ReleaseAligned(p);
+}
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept
+{
+	bench::ReleaseAligned(p);
+}
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept
+{
+	bench::ReleaseAligned(p);
+}
@@ -0,0 +1,1300 @@
+//ECS·׼ԣϷ򹹽ҪGPU
+//cl /std:c++17 /O2 /EHsc /DECS_HEADLESS /I.. EcsBench.cpp
+//LinuxڱĿ¼ִmake runmake jsonbench.json
+//--filter <Ӵ> ֻв--json <ļ> ns/opallocs/opֵפڴ
+
+#include "../ECS.h"
+#include "../Message.h"
+#include "Bench.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <typeindex>
+#include <unordered_map>
+#include <utility>
+
+struct BenchCom
+{
+	float x;
+	float y;
+	float alpha;
+	uint32_t flags;
+};
+template<>
+struct ecs::Serializer<BenchCom> : ecs::PodSerializer<BenchCom>
+{
+	static constexpr const char* name = "BenchCom";
+};
+
+//صĻ˳addgetremove˳forEach
+void BenchPoolOps(size_t count)
+{
+	auto ids = bench::ShuffledIds(count);
+	const size_t rounds = std::max<size_t>(1000000 / count, 1);
+	ecs::ComponentPool<BenchCom> pool;
+	const std::string suffix = " " + std::to_string(count);
+
+	bench::Run("ComponentPool::add" + suffix, count * rounds, [&]()
+		{
+			for (size_t r = 0; r < rounds; ++r)
+			{
+				pool.clear();
+				for (auto id : ids)
+				{
+					pool.add(id, BenchCom{ float(id), float(id), 1.0f, uint32_t(id) });
+				}
+			}
+			bench::Consume(pool.size());
+		});
+	std::shuffle(ids.begin(), ids.end(), std::mt19937(7));
+	bench::Run("ComponentPool::get" + suffix, count * rounds, [&]()
+		{
+			uint64_t sum = 0;
+			for (size_t r = 0; r < rounds; ++r)
+			{
+				for (auto id : ids)
+				{
+					sum += pool.get(id)->flags;
+				}
+			}
+			bench::Consume(sum);
+		});
+	bench::Run("ComponentPool::forEach" + suffix, count * rounds, [&]()
+		{
+			for (size_t r = 0; r < rounds; ++r)
+			{
+				pool.forEach([](ecs::entity, BenchCom& com)
+					{
+						com.x += com.alpha;
+					});
+			}
+			bench::Consume(pool.get(ids[0])->x);
+		});
+	double seconds = 0.0;
+	bench::ResetPeakRss();
+	for (size_t r = 0; r < rounds; ++r)
+	{
+		if (r > 0)
+		{
+			for (auto id : ids)
+			{
+				pool.add(id, BenchCom{ float(id), float(id), 1.0f, uint32_t(id) });
+			}
+		}
+		auto begin = std::chrono::steady_clock::now();
+		for (auto id : ids)
+		{
+			pool.remove(id);
+		}
+		seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+	}
+	bench::Record("ComponentPool::remove" + suffix, count * rounds, seconds);
+}
+
+//ʵidķգԾʵΪcountÿֻղ·һ
+void BenchIdChurn(size_t count)
+{
+	ecs::IdManager idm;
+	std::vector<ecs::entity> live = idm.getIds(count);
+	std::mt19937 rng(3);
+	constexpr size_t rounds = 100;
+	const size_t half = count / 2;
+
+	bench::Run("IdManager churn " + std::to_string(count), half * rounds * 2, [&]()
+		{
+			for (size_t r = 0; r < rounds; ++r)
+			{
+				for (size_t i = 0; i < half; ++i)
+				{
+					const size_t k = rng() % live.size();
+					idm.recycleId(live[k]);
+					live[k] = live.back();
+					live.pop_back();
+				}
+				for (size_t i = 0; i < half; ++i)
+				{
+					live.push_back(idm.getId());
+				}
+			}
+			bench::Consume(idm.size());
+		});
+}
+
+class BenchMsg : public ecs::MessageBase
+{
+public:
+	uint32_t value;
+	BenchMsg(ecs::entity sender, ecs::MessageTypeId type, uint32_t value) : MessageBase(sender, type), value(value) {}
+};
+
+//Ϣһ֡͵ǻԾУswapsendAllַ߶ȡһswap
+//ÿopΪһϢ鲥ÿfanoutĿ꣬㲥ÿȫ
+void BenchMessages(size_t subscribers, size_t perFrame)
+{
+	constexpr size_t frames = 50;
+	constexpr size_t fanout = 8;
+	const std::string suffix = " " + std::to_string(perFrame) + "/frame " + std::to_string(subscribers) + " subs";
+	std::vector<ecs::entity> subs(subscribers);
+	for (size_t i = 0; i < subscribers; ++i)
+	{
+		subs[i] = i;
+	}
+	std::vector<std::vector<ecs::entity>> groups(perFrame);
+	std::mt19937 rng(13);
+	for (auto& g : groups)
+	{
+		for (size_t k = 0; k < fanout; ++k)
+		{
+			g.push_back(subs[rng() % subscribers]);
+		}
+	}
+
+	auto run = [&](const std::string& name, size_t messages, auto&& send)
+		{
+			ecs::MessageManager mm;
+			for (auto id : subs)
+			{
+				mm.subscribe(id);
+			}
+			const ecs::MessageTypeId type = mm.getMessageTypeManager().registeredType<BenchMsg>();
+			bench::Run(name + suffix, messages * frames, [&]()
+				{
+					uint64_t received = 0;
+					for (size_t f = 0; f < frames; ++f)
+					{
+						send(mm, type);
+						mm.swap();
+						mm.sendAll();
+						for (size_t i = 0; i < subscribers; i += 97)
+						{
+							received += mm.getMessageList(subs[i])->size();
+						}
+					}
+					bench::Consume(received);
+				});
+		};
+	run("MessageManager unicast", perFrame, [&](ecs::MessageManager& mm, ecs::MessageTypeId type)
+		{
+			for (size_t i = 0; i < perFrame; ++i)
+			{
+				mm.addUnicastMessage<BenchMsg>(subs[i % subscribers], 0, type, uint32_t(i));
+			}
+		});
+	run("MessageManager multicast x" + std::to_string(fanout), perFrame, [&](ecs::MessageManager& mm, ecs::MessageTypeId type)
+		{
+			for (size_t i = 0; i < perFrame; ++i)
+			{
+				mm.addMulticastMessage<BenchMsg>(groups[i], 0, type, uint32_t(i));
+			}
+		});
+	const size_t broadcasts = std::max<size_t>(perFrame / 64, 1);
+	run("MessageManager broadcast", broadcasts, [&](ecs::MessageManager& mm, ecs::MessageTypeId type)
+		{
+			for (size_t i = 0; i < broadcasts; ++i)
+			{
+				mm.addBroadcastMessage<BenchMsg>(0, type, uint32_t(i));
+			}
+		});
+}
+
+//ťʽ鲥ÿ֡perFrameͬһfanoutߣĿбƽCSR壩ԤȵǼǵĿ
+void BenchMulticastTargets(size_t fanout, size_t perFrame)
+{
+	constexpr size_t frames = 50;
+	constexpr size_t subscribers = 1024;
+	std::vector<ecs::entity> listeners;
+	for (size_t i = 0; i < fanout; ++i)
+	{
+		listeners.push_back(i * 97 % subscribers);
+	}
+	auto run = [&](const std::string& name, auto&& send)
+		{
+			ecs::MessageManager mm;
+			for (size_t i = 0; i < subscribers; ++i)
+			{
+				mm.subscribe(i);
+			}
+			const ecs::MessageTypeId type = mm.getMessageTypeManager().registeredType<BenchMsg>();
+			const ecs::TargetGroupId group = mm.createTargetGroup(listeners);
+			//Ԥһ֡ʹϢбλ
+			send(mm, type, group);
+			mm.swap();
+			mm.sendAll();
+			bench::Run(name + " x" + std::to_string(fanout) + " " + std::to_string(perFrame) + "/frame", perFrame * frames, [&]()
+				{
+					for (size_t f = 0; f < frames; ++f)
+					{
+						send(mm, type, group);
+						mm.swap();
+						mm.sendAll();
+					}
+					bench::Consume(mm.getMessageList(listeners[0])->size());
+				});
+		};
+	run("multicast target list", [&](ecs::MessageManager& mm, ecs::MessageTypeId type, ecs::TargetGroupId)
+		{
+			for (size_t i = 0; i < perFrame; ++i)
+			{
+				mm.addMulticastMessage<BenchMsg>(listeners, 0, type, uint32_t(i));
+			}
+		});
+	run("multicast target group", [&](ecs::MessageManager& mm, ecs::MessageTypeId type, ecs::TargetGroupId group)
+		{
+			for (size_t i = 0; i < perFrame; ++i)
+			{
+				mm.addMulticastMessage<BenchMsg>(group, 0, type, uint32_t(i));
+			}
+		});
+}
+
+//ÿ֡perFrameÿmake_uniqueľɽӿarenaֱӹ죬arenaĿڵһ֡
+void BenchMessageAlloc(size_t perFrame)
+{
+	constexpr size_t frames = 20;
+	constexpr size_t subscribers = 1024;
+	auto run = [&](const std::string& name, auto&& send)
+		{
+			ecs::MessageManager mm;
+			for (size_t i = 0; i < subscribers; ++i)
+			{
+				mm.subscribe(i);
+			}
+			const ecs::MessageTypeId type = mm.getMessageTypeManager().registeredType<BenchMsg>();
+			//Ԥһ֣ʹַʽĶϢбѵλֻȽϢķ
+			for (size_t f = 0; f < 2; ++f)
+			{
+				send(mm, type);
+				mm.swap();
+				mm.sendAll();
+			}
+			bench::Run(name + " " + std::to_string(perFrame) + "/frame", perFrame * frames, [&]()
+				{
+					for (size_t f = 0; f < frames; ++f)
+					{
+						send(mm, type);
+						mm.swap();
+						mm.sendAll();
+					}
+					bench::Consume(mm.getMessageList(0)->size());
+				});
+		};
+	run("message unique_ptr", [&](ecs::MessageManager& mm, ecs::MessageTypeId type)
+		{
+			for (size_t i = 0; i < perFrame; ++i)
+			{
+				mm.addUnicastMessage(std::make_unique<BenchMsg>(0, type, uint32_t(i)), i % subscribers);
+			}
+		});
+	run("message arena", [&](ecs::MessageManager& mm, ecs::MessageTypeId type)
+		{
+			for (size_t i = 0; i < perFrame; ++i)
+			{
+				mm.addUnicastMessage<BenchMsg>(i % subscribers, 0, type, uint32_t(i));
+			}
+		});
+}
+
+//threads߳ͬʱperThread߳һдͬһ壨ԭ·߳Լ߱дݴ
+//opΪһϢʱ̵߳
+void BenchMessageProducers(size_t threads, size_t perThread)
+{
+	constexpr size_t subscribers = 1024;
+	auto run = [&](const std::string& name, auto&& post)
+		{
+			bench::Run(name + " x" + std::to_string(threads) + " threads", threads * perThread, [&]()
+				{
+					std::vector<std::thread> workers;
+					for (size_t t = 0; t < threads; ++t)
+					{
+						workers.emplace_back([&post, t]() { post(t); });
+					}
+					for (auto& worker : workers)
+					{
+						worker.join();
+					}
+				});
+		};
+
+	{
+		std::mutex mutex;
+		ecs::MessageQueue queue;
+		run("message post mutex", [&](size_t t)
+			{
+				for (size_t i = 0; i < perThread; ++i)
+				{
+					std::lock_guard lock(mutex);
+					queue.unicast.push_back(queue.arena.create<BenchMsg>(t, 0, uint32_t(i)));
+					queue.unicastTargets.push_back(i % subscribers);
+				}
+			});
+		bench::Consume(queue.unicast.size());
+	}
+	{
+		ecs::MessageManager mm;
+		for (size_t i = 0; i < subscribers; ++i)
+		{
+			mm.subscribe(i);
+		}
+		const ecs::MessageTypeId type = mm.getMessageTypeManager().registeredType<BenchMsg>();
+		run("message post lanes", [&](size_t t)
+			{
+				ecs::MessageProducerScope producer(t);
+				for (size_t i = 0; i < perThread; ++i)
+				{
+					mm.addUnicastMessage<BenchMsg>(i % subscribers, t, type, uint32_t(i));
+				}
+			});
+		mm.swap();
+		mm.sendAll();
+		bench::Consume(mm.getMessageList(0)->size());
+	}
+}
+
+//interestedʵϢÿ֡perFrameǣÿ֡getMessageListѯעᴦsendAllֱӵ
+//opΪһ֡swapsendAll
+void BenchMessageHandlers(size_t interested, size_t perFrame)
+{
+	constexpr size_t frames = 10000;
+	const std::string suffix = " " + std::to_string(interested) + " targets " + std::to_string(perFrame) + "/frame";
+	auto run = [&](const std::string& name, auto&& setup, auto&& consume)
+		{
+			ecs::MessageManager mm;
+			for (size_t i = 0; i < interested; ++i)
+			{
+				mm.subscribe(i);
+			}
+			const ecs::MessageTypeId type = mm.getMessageTypeManager().registeredType<BenchMsg>();
+			uint64_t received = 0;
+			setup(mm, received);
+			std::mt19937 rng(17);
+			bench::Run(name + suffix, frames, [&]()
+				{
+					for (size_t f = 0; f < frames; ++f)
+					{
+						for (size_t i = 0; i < perFrame; ++i)
+						{
+							mm.addUnicastMessage<BenchMsg>(rng() % interested, 0, type, uint32_t(i));
+						}
+						mm.swap();
+						mm.sendAll();
+						consume(mm, received);
+					}
+				});
+			bench::Consume(received);
+		};
+	run("message poll", [](ecs::MessageManager&, uint64_t&) {}, [&](ecs::MessageManager& mm, uint64_t& received)
+		{
+			for (size_t i = 0; i < interested; ++i)
+			{
+				auto list = mm.getMessageList(i);
+				if (list != nullptr && list->size() > 0)
+				{
+					++received;
+				}
+			}
+		});
+	run("message handler", [&](ecs::MessageManager& mm, uint64_t& received)
+		{
+			for (size_t i = 0; i < interested; ++i)
+			{
+				mm.addHandler<BenchMsg>(i, [&received](const BenchMsg&) { ++received; });
+			}
+		}, [](ecs::MessageManager&, uint64_t&) {});
+}
+
+//·뵥д׶ε·Ĳ
+void BenchPoolLookup(size_t count)
+{
+	ecs::ComponentPool<BenchCom> pool;
+	pool.reserve(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		pool.add(i, BenchCom{ float(i), float(i), 1.0f, uint32_t(i) });
+	}
+	auto ids = bench::ShuffledIds(count);
+	constexpr size_t rounds = 20;
+
+	bench::Run("ComponentPool::get locked " + std::to_string(count), count * rounds, [&]()
+		{
+			uint64_t sum = 0;
+			for (size_t r = 0; r < rounds; ++r)
+			{
+				for (auto id : ids)
+				{
+					sum += pool.get(id)->flags;
+				}
+			}
+			bench::Consume(sum);
+		});
+
+	pool.beginDeferred();
+	bench::Run("ComponentPool::get deferred " + std::to_string(count), count * rounds, [&]()
+		{
+			uint64_t sum = 0;
+			for (size_t r = 0; r < rounds; ++r)
+			{
+				for (auto id : ids)
+				{
+					sum += pool.get(id)->flags;
+				}
+			}
+			bench::Consume(sum);
+		});
+	pool.sync();
+}
+
+//forEachֿ鲢forEachĽ
+void BenchParallelForEach(ThreadPool& tp)
+{
+	for (size_t count : { 256, 1024, 4096, 16384, 65536, 262144, 1048576 })
+	{
+		ecs::ComponentPool<BenchCom> pool;
+		pool.reserve(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			pool.add(i, BenchCom{ float(i), float(i), 1.0f, uint32_t(i) });
+		}
+		auto kernel = [](ecs::entity, BenchCom& com)
+			{
+				com.x = com.x * 0.99f + com.alpha;
+				com.y = com.y * 0.98f + com.x * 0.5f;
+			};
+		const size_t rounds = std::max<size_t>(4194304 / count, 1);
+
+		bench::Run("ComponentPool::forEach serial " + std::to_string(count), count * rounds, [&]()
+			{
+				for (size_t r = 0; r < rounds; ++r)
+				{
+					pool.forEach(kernel);
+				}
+			});
+		for (size_t grain : { 256, 4096 })
+		{
+			pool.setGrainSize(grain);
+			bench::Run("ComponentPool::forEach parallel " + std::to_string(count) + " grain " + std::to_string(grain), count * rounds, [&]()
+				{
+					for (size_t r = 0; r < rounds; ++r)
+					{
+						pool.forEach(tp, kernel);
+					}
+				});
+		}
+	}
+}
+
+//ÿ֡帴 comInactive = comActive ֻͬmodifyǵ
+void BenchDirtySwap(size_t count)
+{
+	ecs::ComponentPool<BenchCom> pool0;
+	ecs::ComponentPool<BenchCom> pool1;
+	for (size_t i = 0; i < count; ++i)
+	{
+		pool0.add(i, BenchCom{ float(i), float(i), 1.0f, uint32_t(i) });
+		pool1.add(i, BenchCom{ float(i), float(i), 1.0f, uint32_t(i) });
+	}
+	ecs::DoubleComs<BenchCom> coms(&pool0, &pool1, true);
+	auto ids = bench::ShuffledIds(count);
+	constexpr size_t frames = 100;
+
+	bench::Run("DoubleBuffered full copy " + std::to_string(count), count * frames, [&]()
+		{
+			for (size_t f = 0; f < frames; ++f)
+			{
+				coms.active()->forEach([&](ecs::entity id, BenchCom& com)
+					{
+						*coms.inactive()->get(id) = com;
+					});
+				coms.swap();
+			}
+		});
+	for (size_t percent : { 1, 10, 100 })
+	{
+		const size_t changed = count * percent / 100;
+		size_t copies = 0;
+		const bench::Result result = bench::Run("DoubleBuffered dirty " + std::to_string(percent) + "% " + std::to_string(count), count * frames, [&]()
+			{
+				for (size_t f = 0; f < frames; ++f)
+				{
+					for (size_t i = 0; i < changed; ++i)
+					{
+						coms.inactive()->modify(ids[(f * changed + i) % count])->x += 1.0f;
+					}
+					coms.swap();
+					copies += coms.stats().copies;
+				}
+			});
+		if (result.ops > 0)
+		{
+			std::printf("%-48s %12zu copies/frame\n", "", copies / frames);
+		}
+	}
+}
+
+template<int N>
+struct TypedCom
+{
+	uint32_t value;
+};
+
+//World2D::getDoubleBufferʵ֣type_indexϣ밴ComponentTypeId
+//-fno-rttiʱֻк
+#if defined(__GXX_RTTI) || defined(_CPPRTTI)
+#define ECS_BENCH_RTTI
+#endif
+template<int ...Ns>
+void BenchTypeLookup(std::integer_sequence<int, Ns...>)
+{
+	std::vector<std::unique_ptr<ecs::DoubleBufferedBase>> byTypeId;
+	ecs::ComponentPool<BenchCom> pool;
+	auto make = [&pool]() { return std::unique_ptr<ecs::DoubleBufferedBase>(new ecs::DoubleComs<BenchCom>(&pool, &pool, true)); };
+	byTypeId.resize(std::max({ ecs::ComponentTypeId<TypedCom<Ns>>()... }) + 1);
+	((byTypeId[ecs::ComponentTypeId<TypedCom<Ns>>()] = make()), ...);
+	constexpr size_t rounds = 1000000;
+	constexpr size_t types = sizeof...(Ns);
+
+#ifdef ECS_BENCH_RTTI
+	std::unordered_map<std::type_index, std::unique_ptr<ecs::DoubleBufferedBase>> byTypeIndex;
+	(byTypeIndex.emplace(std::type_index(typeid(TypedCom<Ns>)), make()), ...);
+	bench::Run("getDoubleBuffer type_index map " + std::to_string(types) + " types", rounds * types, [&]()
+		{
+			uintptr_t sum = 0;
+			for (size_t r = 0; r < rounds; ++r)
+			{
+				((sum += uintptr_t(byTypeIndex.find(std::type_index(typeid(TypedCom<Ns>)))->second.get())), ...);
+			}
+			bench::Consume(sum);
+		});
+#endif
+	bench::Run("getDoubleBuffer ComponentTypeId array " + std::to_string(types) + " types", rounds * types, [&]()
+		{
+			uintptr_t sum = 0;
+			for (size_t r = 0; r < rounds; ++r)
+			{
+				((sum += uintptr_t(byTypeId[ecs::ComponentTypeId<TypedCom<Ns>>()].get())), ...);
+			}
+			bench::Consume(sum);
+		});
+}
+
+//ɾ200ʵ壺ʵremove밴ǩͰremoveBatch
+void BenchTeardown(size_t worldSize)
+{
+	const std::string suffix = " world " + std::to_string(worldSize);
+	if (!bench::Selected("teardown per pool remove" + suffix) && !bench::Selected("teardown signature batch" + suffix))
+	{
+		return;
+	}
+	constexpr size_t poolCount = 16;
+	constexpr size_t deleted = 200;
+	constexpr size_t rounds = 50;
+	auto fill = [worldSize](std::vector<std::unique_ptr<ecs::ComponentPoolBase>>& pools)
+		{
+			pools.clear();
+			for (size_t p = 0; p < poolCount; ++p)
+			{
+				auto pool = std::make_unique<ecs::ComponentPool<BenchCom>>();
+				for (size_t i = p; i < worldSize; i += poolCount / 2)
+				{
+					pool->add(i, BenchCom{ float(i), float(i), 1.0f, uint32_t(i) });
+				}
+				pools.push_back(std::move(pool));
+			}
+		};
+	std::vector<ecs::entity> victims;
+	for (size_t i = 0; i < deleted; ++i)
+	{
+		victims.push_back(i * (worldSize / deleted));
+	}
+	std::vector<std::unique_ptr<ecs::ComponentPoolBase>> pools;
+	double perEntity = 0.0;
+	double batched = 0.0;
+	bench::ResetPeakRss();
+	for (size_t r = 0; r < rounds; ++r)
+	{
+		fill(pools);
+		auto begin = std::chrono::steady_clock::now();
+		for (auto id : victims)
+		{
+			for (auto& pool : pools)
+			{
+				pool->remove(id);
+			}
+		}
+		perEntity += std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+		fill(pools);
+		begin = std::chrono::steady_clock::now();
+		std::vector<std::vector<ecs::entity>> buckets(poolCount);
+		for (auto id : victims)
+		{
+			buckets[id % (poolCount / 2)].push_back(id);
+			buckets[id % (poolCount / 2) + poolCount / 2].push_back(id);
+		}
+		for (size_t p = 0; p < poolCount; ++p)
+		{
+			pools[p]->removeBatch(buckets[p].data(), buckets[p].size());
+		}
+		batched += std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+	}
+	bench::Record("teardown per pool remove" + suffix, rounds * deleted, perEntity);
+	bench::Record("teardown signature batch" + suffix, rounds * deleted, batched);
+}
+
+//entityToIndexڲͬidֲµڴ棺ҳϡ밴id
+void BenchSparseMemory()
+{
+	if (!bench::Selected("entityToIndex"))
+	{
+		return;
+	}
+	constexpr size_t live = 10000;
+	std::mt19937 rng(7);
+	std::vector<std::pair<std::string, std::vector<uint32_t>>> layouts;
+
+	std::vector<uint32_t> dense(live);
+	for (size_t i = 0; i < live; ++i)
+	{
+		dense[i] = uint32_t(i);
+	}
+	layouts.emplace_back("dense", dense);
+
+	std::vector<uint32_t> clustered;
+	while (clustered.size() < live)
+	{
+		const uint32_t base = rng() % (1u << 24);
+		for (uint32_t k = 0; k < 256 && clustered.size() < live; ++k)
+		{
+			clustered.push_back(base + k);
+		}
+	}
+	layouts.emplace_back("clusters of 256 in 2^24", clustered);
+
+	std::vector<uint32_t> uniform(live);
+	for (auto& id : uniform)
+	{
+		id = rng() % (1u << 24);
+	}
+	layouts.emplace_back("uniform in 2^24", uniform);
+
+	std::vector<uint32_t> single(1, (1u << 24) - 1);
+	layouts.emplace_back("single high id", single);
+
+	for (auto& [name, ids] : layouts)
+	{
+		ecs::PagedSparseArray sparse;
+		for (size_t i = 0; i < ids.size(); ++i)
+		{
+			sparse.set(ids[i], i);
+		}
+		const size_t maxId = *std::max_element(ids.begin(), ids.end());
+		const size_t flat = (maxId + 20) * sizeof(uint64_t);
+		const size_t paged = sparse.memoryUsage();
+		std::printf("%-48s %10zu KiB paged %10zu KiB flat\n", ("entityToIndex " + name).c_str(), paged / 1024, flat / 1024);
+	}
+}
+
+//createUnitʽaddһΣaddBatch
+void BenchBulkCreate(size_t count)
+{
+	std::vector<ecs::entity> ids(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		ids[i] = i;
+	}
+	std::vector<BenchCom> source(count);
+	constexpr size_t rounds = 20;
+
+	bench::Run("createUnit-style add x2 " + std::to_string(count), count * rounds, [&]()
+		{
+			for (size_t r = 0; r < rounds; ++r)
+			{
+				ecs::ComponentPool<BenchCom> pool0;
+				ecs::ComponentPool<BenchCom> pool1;
+				for (size_t i = 0; i < count; ++i)
+				{
+					pool0.add(ids[i], source[i]);
+					pool1.add(ids[i], source[i]);
+				}
+				bench::Consume(pool0.size() + pool1.size());
+			}
+		});
+	bench::Run("addBatch x2 " + std::to_string(count), count * rounds, [&]()
+		{
+			for (size_t r = 0; r < rounds; ++r)
+			{
+				ecs::ComponentPool<BenchCom> pool0;
+				ecs::ComponentPool<BenchCom> pool1;
+				pool0.addBatch(ids.data(), source.begin(), count);
+				pool1.addBatch(ids.data(), std::make_move_iterator(source.begin()), count);
+				bench::Consume(pool0.size() + pool1.size());
+			}
+		});
+}
+
+//նдPOD鸴ƣԱaddؽͬ
+void BenchSnapshot(size_t count)
+{
+	std::vector<ecs::entity> ids(count);
+	std::vector<BenchCom> source(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		ids[i] = i;
+		source[i] = BenchCom{ float(i), float(i), 1.0f, uint32_t(i) };
+	}
+	ecs::ComponentPool<BenchCom> pool;
+	pool.addBatch(ids.data(), source.begin(), count);
+	constexpr size_t rounds = 20;
+
+	ecs::BinaryWriter out;
+	pool.save(out);
+	bench::Run("snapshot save " + std::to_string(count), count * rounds, [&]()
+		{
+			for (size_t r = 0; r < rounds; ++r)
+			{
+				ecs::BinaryWriter writer;
+				writer.reserve(out.size());
+				pool.save(writer);
+				bench::Consume(writer.size());
+			}
+		});
+	bench::Run("snapshot load " + std::to_string(count), count * rounds, [&]()
+		{
+			for (size_t r = 0; r < rounds; ++r)
+			{
+				ecs::ComponentPool<BenchCom> restored;
+				ecs::BinaryReader in(out.data().data(), out.size());
+				restored.load(in);
+				bench::Consume(restored.size());
+			}
+		});
+	bench::Run("rebuild by addBatch " + std::to_string(count), count * rounds, [&]()
+		{
+			for (size_t r = 0; r < rounds; ++r)
+			{
+				ecs::ComponentPool<BenchCom> restored;
+				restored.addBatch(ids.data(), source.begin(), count);
+				bench::Consume(restored.size());
+			}
+		});
+}
+
+//ƶľ飺ÿ֡moveԱÿ֡պadd
+void BenchQuadTreeMove(size_t count)
+{
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<float> posX(0.0f, 1920.0f);
+	std::uniform_real_distribution<float> posY(0.0f, 1080.0f);
+	std::uniform_real_distribution<float> half(4.0f, 16.0f);
+	std::uniform_real_distribution<float> speed(-3.0f, 3.0f);
+	std::vector<Vector2> pos(count);
+	std::vector<Vector2> vel(count);
+	std::vector<float> size(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		pos[i] = { posX(rng), posY(rng) };
+		vel[i] = { speed(rng), speed(rng) };
+		size[i] = half(rng);
+	}
+	const ecs::AABB world({ 960.0f, 540.0f }, 960.0f, 540.0f);
+	constexpr size_t frames = 100;
+	auto step = [&](std::vector<Vector2>& p)
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				p[i].x += vel[i].x;
+				p[i].y += vel[i].y;
+				if (p[i].x < 0.0f || p[i].x > 1920.0f)
+				{
+					vel[i].x = -vel[i].x;
+				}
+				if (p[i].y < 0.0f || p[i].y > 1080.0f)
+				{
+					vel[i].y = -vel[i].y;
+				}
+			}
+		};
+
+	std::vector<Vector2> p = pos;
+	ecs::QuadTree moving(world);
+	for (size_t i = 0; i < count; ++i)
+	{
+		moving.add(i, ecs::AABB(p[i], size[i]));
+	}
+	bench::Run("QuadTree move " + std::to_string(count) + " x" + std::to_string(frames), count * frames, [&]()
+		{
+			for (size_t f = 0; f < frames; ++f)
+			{
+				step(p);
+				for (size_t i = 0; i < count; ++i)
+				{
+					moving.move(i, ecs::AABB(p[i], size[i]));
+				}
+			}
+			bench::Consume(moving.size());
+		});
+
+	p = pos;
+	ecs::QuadTree rebuilt(world);
+	bench::Run("QuadTree rebuild " + std::to_string(count) + " x" + std::to_string(frames), count * frames, [&]()
+		{
+			for (size_t f = 0; f < frames; ++f)
+			{
+				step(p);
+				rebuilt.destroy();
+				for (size_t i = 0; i < count; ++i)
+				{
+					rebuilt.add(i, ecs::AABB(p[i], size[i]));
+				}
+			}
+			bench::Consume(rebuilt.size());
+		});
+}
+
+//ÿ֡ؽĲĻԱQuadTreeaddٱȽһСΧѯ
+void BenchLinearQuadTree(size_t count, size_t queries)
+{
+	std::mt19937 rng(11);
+	std::uniform_real_distribution<float> posX(0.0f, 1920.0f);
+	std::uniform_real_distribution<float> posY(0.0f, 1080.0f);
+	std::uniform_real_distribution<float> half(1.0f, 4.0f);
+	std::vector<ecs::entity> ids(count);
+	std::vector<ecs::AABB> boxes(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		ids[i] = i;
+		boxes[i] = ecs::AABB({ posX(rng), posY(rng) }, half(rng));
+	}
+	std::vector<ecs::AABB> targets(queries);
+	for (auto& t : targets)
+	{
+		t = ecs::AABB({ posX(rng), posY(rng) }, 32.0f);
+	}
+	const ecs::AABB world({ 960.0f, 540.0f }, 960.0f, 540.0f);
+	constexpr size_t rounds = 20;
+
+	ecs::LinearQuadTree linear(world);
+	bench::Run("LinearQuadTree rebuild " + std::to_string(count), count * rounds, [&]()
+		{
+			for (size_t r = 0; r < rounds; ++r)
+			{
+				linear.rebuild(ids, boxes);
+			}
+			bench::Consume(linear.size());
+		});
+	ecs::QuadTree tree(world);
+	bench::Run("QuadTree rebuild " + std::to_string(count), count * rounds, [&]()
+		{
+			for (size_t r = 0; r < rounds; ++r)
+			{
+				tree.destroy();
+				for (size_t i = 0; i < count; ++i)
+				{
+					tree.add(ids[i], boxes[i]);
+				}
+			}
+			bench::Consume(tree.size());
+		});
+
+	std::vector<ecs::LinearQuadTree::Span> spans;
+	std::vector<uint32_t> offsets;
+	bench::Run("LinearQuadTree queryBatch " + std::to_string(queries), queries * rounds, [&]()
+		{
+			size_t hits = 0;
+			for (size_t r = 0; r < rounds; ++r)
+			{
+				linear.queryBatch(targets.data(), targets.size(), spans, offsets);
+				for (size_t q = 0; q < queries; ++q)
+				{
+					for (uint32_t k = offsets[q]; k < offsets[q + 1]; ++k)
+					{
+						for (uint32_t i = spans[k].begin; i < spans[k].end; ++i)
+						{
+							hits += linear.aabbs()[i].isCross(targets[q]);
+						}
+					}
+				}
+			}
+			bench::Consume(hits);
+		});
+	std::vector<ecs::entity> result;
+	bench::Run("QuadTree query " + std::to_string(queries), queries * rounds, [&]()
+		{
+			size_t hits = 0;
+			for (size_t r = 0; r < rounds; ++r)
+			{
+				for (auto& t : targets)
+				{
+					result.clear();
+					tree.query(t, result);
+					hits += result.size();
+				}
+			}
+			bench::Consume(hits);
+		});
+}
+
+//һΧжһΧУAABB::isCross밴ŵģѹ±б
+void BenchAabbBatch(size_t count)
+{
+	std::mt19937 rng(9);
+	std::uniform_real_distribution<float> pos(0.0f, 1000.0f);
+	std::uniform_real_distribution<float> half(1.0f, 20.0f);
+	std::vector<ecs::AABB> boxes(count);
+	ecs::AabbBatch batch;
+	for (auto& b : boxes)
+	{
+		b = ecs::AABB({ pos(rng), pos(rng) }, half(rng), half(rng));
+		batch.push(b);
+	}
+	std::vector<float> minX(count), minY(count), maxX(count), maxY(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		const Vector2 c = boxes[i].getPosition();
+		minX[i] = c.x - boxes[i].getXHarfLength();
+		minY[i] = c.y - boxes[i].getYHarfLength();
+		maxX[i] = c.x + boxes[i].getXHarfLength();
+		maxY[i] = c.y + boxes[i].getYHarfLength();
+	}
+	const ecs::AABB target({ 500.0f, 500.0f }, 150.0f, 150.0f);
+	constexpr size_t rounds = 200;
+	std::vector<uint32_t> out;
+	out.reserve(count);
+
+	bench::Run("AABB isCross " + std::to_string(count), count * rounds, [&]()
+		{
+			for (size_t r = 0; r < rounds; ++r)
+			{
+				out.clear();
+				for (size_t i = 0; i < count; ++i)
+				{
+					if (boxes[i].isCross(target))
+					{
+						out.push_back(uint32_t(i));
+					}
+				}
+			}
+			bench::Consume(out.size());
+		});
+	using Kernel = uint64_t(*)(const float*, const float*, const float*, const float*, size_t, const ecs::AABB&);
+	auto runKernel = [&](const char* name, Kernel kernel)
+		{
+			bench::Run(std::string(name) + " " + std::to_string(count), count * rounds, [&]()
+				{
+					for (size_t r = 0; r < rounds; ++r)
+					{
+						out.clear();
+						for (size_t base = 0; base < count; base += 64)
+						{
+							const size_t n = std::min<size_t>(64, count - base);
+							for (uint64_t mask = kernel(&minX[base], &minY[base], &maxX[base], &maxY[base], n, target); mask != 0; mask &= mask - 1)
+							{
+								out.push_back(uint32_t(base + ecs::LowestBit(mask)));
+							}
+						}
+					}
+					bench::Consume(out.size());
+				});
+		};
+	runKernel("CrossMaskScalar", ecs::CrossMaskScalar);
+#ifdef ECS_SIMD_SSE
+	runKernel("CrossMaskSse", ecs::CrossMaskSse);
+#endif
+#ifdef ECS_SIMD_AVX2
+	runKernel("CrossMaskAvx2", ecs::CrossMaskAvx2);
+#endif
+	bench::Run("AabbBatch crossIndices " + std::to_string(count), count * rounds, [&]()
+		{
+			for (size_t r = 0; r < rounds; ++r)
+			{
+				out.clear();
+				batch.crossIndices(target, out);
+			}
+			bench::Consume(out.size());
+		});
+}
+
+//ཻAABB::isCrossλȽϣΧУϵı߽ӡNaNİΧ
+void CheckCrossMask(size_t batches)
+{
+	const std::string name = "check CrossMask kernels vs isCross";
+	if (!bench::Selected(name))
+	{
+		return;
+	}
+	std::mt19937 rng(19);
+	std::uniform_real_distribution<float> pos(0.0f, 100.0f);
+	std::uniform_real_distribution<float> half(0.0f, 10.0f);
+	std::uniform_int_distribution<int> grid(0, 20);
+	std::uniform_int_distribution<size_t> length(0, 150);
+	auto randomBox = [&]()
+		{
+			switch (grid(rng) % 8)
+			{
+			case 0://
+				return ecs::AABB({ float(grid(rng) * 5), float(grid(rng) * 5) }, 0.0f, 0.0f);
+			case 1:
+			case 2://ϵ߽磬ǡ
+				return ecs::AABB({ float(grid(rng) * 5), float(grid(rng) * 5) }, float(grid(rng) % 3) * 2.5f, float(grid(rng) % 3) * 2.5f);
+			case 3:
+				return ecs::AABB({ grid(rng) == 0 ? std::numeric_limits<float>::quiet_NaN() : pos(rng), pos(rng) }, half(rng), half(rng));
+			default:
+				return ecs::AABB({ pos(rng), pos(rng) }, half(rng), half(rng));
+			}
+		};
+	bool ok = true;
+	std::vector<ecs::AABB> boxes;
+	std::vector<float> minX, minY, maxX, maxY;
+	std::vector<uint64_t> masks;
+	for (size_t b = 0; b < batches && ok; ++b)
+	{
+		const size_t n = length(rng);
+		ecs::AabbBatch batch;
+		boxes.clear();
+		minX.clear();
+		minY.clear();
+		maxX.clear();
+		maxY.clear();
+		for (size_t i = 0; i < n; ++i)
+		{
+			boxes.push_back(randomBox());
+			batch.push(boxes.back());
+			const Vector2 c = boxes.back().getPosition();
+			minX.push_back(c.x - boxes.back().getXHarfLength());
+			minY.push_back(c.y - boxes.back().getYHarfLength());
+			maxX.push_back(c.x + boxes.back().getXHarfLength());
+			maxY.push_back(c.y + boxes.back().getYHarfLength());
+		}
+		const ecs::AABB target = randomBox();
+		batch.crossMask(target, masks);
+		for (size_t base = 0; base < n; base += 64)
+		{
+			const size_t count = std::min<size_t>(64, n - base);
+			uint64_t expected = 0;
+			for (size_t i = 0; i < count; ++i)
+			{
+				expected |= uint64_t(boxes[base + i].isCross(target)) << i;
+			}
+			ok = ok && ecs::CrossMaskScalar(&minX[base], &minY[base], &maxX[base], &maxY[base], count, target) == expected;
+#ifdef ECS_SIMD_SSE
+			ok = ok && ecs::CrossMaskSse(&minX[base], &minY[base], &maxX[base], &maxY[base], count, target) == expected;
+#endif
+#ifdef ECS_SIMD_AVX2
+			ok = ok && ecs::CrossMaskAvx2(&minX[base], &minY[base], &maxX[base], &maxY[base], count, target) == expected;
+#endif
+			ok = ok && masks[base / 64] == expected;
+		}
+	}
+	bench::Check(name, ok);
+}
+
+//вԣui::HitTestIndexͬĲȡϵĺѡٰ㼶ȡϲ㣬ԱؼȽ
+//UI.hraylibںֱʹĲ
+void BenchUiHitTest(size_t count, size_t queries)
+{
+	std::mt19937 rng(5);
+	std::uniform_real_distribution<float> posX(0.0f, 1920.0f);
+	std::uniform_real_distribution<float> posY(0.0f, 1080.0f);
+	std::uniform_real_distribution<float> half(8.0f, 48.0f);
+	std::uniform_int_distribution<int> layer(0, 15);
+	std::vector<ecs::AABB> boxes(count);
+	std::vector<int> layers(count);
+	ecs::QuadTree tree(ecs::AABB({ 960.0f, 540.0f }, 960.0f, 540.0f));
+	for (size_t i = 0; i < count; ++i)
+	{
+		boxes[i] = ecs::AABB({ posX(rng), posY(rng) }, half(rng), half(rng));
+		layers[i] = layer(rng);
+		tree.add(i, boxes[i]);
+	}
+	std::vector<Vector2> points(queries);
+	for (auto& p : points)
+	{
+		p = { posX(rng), posY(rng) };
+	}
+	auto better = [&](size_t i, size_t best)
+		{
+			return best == SIZE_MAX || layers[i] > layers[best] || (layers[i] == layers[best] && i > best);
+		};
+
+	bench::Run("ui hit linear " + std::to_string(count), queries, [&]()
+		{
+			size_t found = 0;
+			for (auto& p : points)
+			{
+				size_t best = SIZE_MAX;
+				for (size_t i = 0; i < count; ++i)
+				{
+					if (boxes[i].isIncluding(p) && better(i, best))
+					{
+						best = i;
+					}
+				}
+				found += best;
+			}
+			bench::Consume(found);
+		});
+	std::vector<ecs::entity> candidates;
+	bench::Run("ui hit QuadTree " + std::to_string(count), queries, [&]()
+		{
+			size_t found = 0;
+			for (auto& p : points)
+			{
+				candidates.clear();
+				tree.query(ecs::AABB(p, 0.0f), candidates);
+				size_t best = SIZE_MAX;
+				for (ecs::entity id : candidates)
+				{
+					if (boxes[id].isIncluding(p) && better(size_t(id), best))
+					{
+						best = size_t(id);
+					}
+				}
+				found += best;
+			}
+			bench::Consume(found);
+		});
+}
+
+//ֵֶΪλ͸ȣΪһݣֲֶͬ
+struct TweenCom
+{
+	float x;
+	float y;
+	float targetX;
+	float targetY;
+	float alpha;
+	float targetAlpha;
+	float speed;
+	uint32_t flags;
+	float originX;
+	float originY;
+	float scale;
+	float rotation;
+	uint32_t color;
+	int32_t layerDepth;
+};
+struct TweenSoaCom : TweenCom {};
+template<>
+struct ecs::SoaLayout<TweenSoaCom> : ecs::SoaFields<&TweenSoaCom::x, &TweenSoaCom::y, &TweenSoaCom::targetX, &TweenSoaCom::targetY,
+	&TweenSoaCom::alpha, &TweenSoaCom::targetAlpha, &TweenSoaCom::speed, &TweenSoaCom::flags, &TweenSoaCom::originX, &TweenSoaCom::originY, &TweenSoaCom::scale, &TweenSoaCom::rotation, &TweenSoaCom::color, &TweenSoaCom::layerDepth> {};
+
+//λ/͸ȲֵṹforEach밴ֶĽѭ
+void BenchTweenLayout(size_t count)
+{
+	constexpr float dt = 1.0f / 60.0f;
+	constexpr size_t rounds = 200;
+
+	ecs::ComponentPool<TweenCom> aos;
+	ecs::ComponentPool<TweenSoaCom> soa;
+	for (size_t i = 0; i < count; ++i)
+	{
+		TweenCom com{ float(i), float(i % 720), float(i % 1280), 360.0f, 0.0f, 1.0f, 4.0f + float(i % 3), uint32_t(i), 0.0f, 0.0f, 1.0f, 0.0f, 0xFFFFFFFFu, int32_t(i % 16) };
+		aos.add(i, com);
+		soa.add(i, TweenSoaCom{ com });
+	}
+
+	bench::Run("tween AoS forEach " + std::to_string(count), count * rounds, [&]()
+		{
+			for (size_t r = 0; r < rounds; ++r)
+			{
+				aos.forEach([dt](ecs::entity, TweenCom& com)
+					{
+						const float t = std::min(com.speed * dt, 1.0f);
+						com.x += (com.targetX - com.x) * t;
+						com.y += (com.targetY - com.y) * t;
+						com.alpha += (com.targetAlpha - com.alpha) * t;
+					});
+			}
+			bench::Consume(aos.get(0)->x);
+		});
+	bench::Run("tween SoA forEachIndex " + std::to_string(count), count * rounds, [&]()
+		{
+			auto x = soa.field<&TweenSoaCom::x>();
+			auto y = soa.field<&TweenSoaCom::y>();
+			auto alpha = soa.field<&TweenSoaCom::alpha>();
+			auto targetX = soa.field<&TweenSoaCom::targetX>();
+			auto targetY = soa.field<&TweenSoaCom::targetY>();
+			auto targetAlpha = soa.field<&TweenSoaCom::targetAlpha>();
+			auto speed = soa.field<&TweenSoaCom::speed>();
+			for (size_t r = 0; r < rounds; ++r)
+			{
+				soa.forEachIndex([=](size_t i)
+					{
+						const float t = std::min(speed[i] * dt, 1.0f);
+						x[i] += (targetX[i] - x[i]) * t;
+						y[i] += (targetY[i] - y[i]) * t;
+						alpha[i] += (targetAlpha[i] - alpha[i]) * t;
+					});
+			}
+			bench::Consume(x[0]);
+		});
+	bench::Run("tween SoA View " + std::to_string(count), count * rounds, [&]()
+		{
+			for (size_t r = 0; r < rounds; ++r)
+			{
+				ecs::View<TweenSoaCom>(&soa).forEach([dt](ecs::entity, auto com)
+					{
+						const float t = std::min(com.template get<&TweenSoaCom::speed>() * dt, 1.0f);
+						float& x = com.template get<&TweenSoaCom::x>();
+						float& y = com.template get<&TweenSoaCom::y>();
+						float& alpha = com.template get<&TweenSoaCom::alpha>();
+						x += (com.template get<&TweenSoaCom::targetX>() - x) * t;
+						y += (com.template get<&TweenSoaCom::targetY>() - y) * t;
+						alpha += (com.template get<&TweenSoaCom::targetAlpha>() - alpha) * t;
+					});
+			}
+			bench::Consume(soa.field<&TweenSoaCom::x>()[0]);
+		});
+}
+
+int main(int argc, char** argv)
+{
+	bench::ParseArgs(argc, argv);
+
+	for (size_t count : { 1000, 10000, 100000 })
+	{
+		BenchPoolOps(count);
+		BenchIdChurn(count);
+	}
+	BenchPoolLookup(10000);
+	BenchPoolLookup(100000);
+	BenchSparseMemory();
+	BenchBulkCreate(100000);
+	BenchSnapshot(100000);
+	BenchQuadTreeMove(10000);
+	BenchLinearQuadTree(5000, 1000);
+	BenchLinearQuadTree(50000, 1000);
+	BenchAabbBatch(4096);
+	CheckCrossMask(20000);
+	BenchUiHitTest(200, 10000);
+	BenchUiHitTest(5000, 10000);
+
+	BenchTweenLayout(50000);
+
+	BenchDirtySwap(10000);
+	BenchDirtySwap(100000);
+
+	BenchMessages(1000, 1000);
+	BenchMessages(10000, 10000);
+	BenchMessageAlloc(100000);
+	BenchMulticastTargets(8, 10000);
+	for (size_t threads : { 1, 2, 4, 8 })
+	{
+		BenchMessageProducers(threads, 200000);
+	}
+	BenchMessageHandlers(1000, 0);
+	BenchMessageHandlers(1000, 10);
+
+	BenchTypeLookup(std::make_integer_sequence<int, 16>());
+
+	BenchTeardown(1000);
+	BenchTeardown(100000);
+
+	ThreadPool tp;
+	BenchParallelForEach(tp);
+	return bench::Finish("EcsBench");
+}
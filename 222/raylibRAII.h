@@ -3,6 +3,9 @@
 #include <raylib.h>
 #include <raymath.h>
 
+#include <string>
+#include <unordered_map>
+
 namespace rlRAII
 {
 	class ImageRAII
@@ -137,12 +140,74 @@ namespace rlRAII
 		}
 	};
 
+	//ļԴ·ݣָʱȸѼص
+	class TextureRegistry
+	{
+	private:
+		struct Entry
+		{
+			std::string path;
+			Texture2D texture;
+			size_t* ref;
+		};
+		std::unordered_map<unsigned int, Entry> byId;
+		std::unordered_map<std::string, unsigned int> byPath;
+
+	public:
+		static TextureRegistry& instance()
+		{
+			static TextureRegistry registry;
+			return registry;
+		}
+		void add(const char* path, const Texture2D& texture, size_t* ref)
+		{
+			byId[texture.id] = Entry{ path, texture, ref };
+			byPath[path] = texture.id;
+		}
+		void remove(const unsigned int id)
+		{
+			auto it = byId.find(id);
+			if (it == byId.end())
+			{
+				return;
+			}
+			auto pathIt = byPath.find(it->second.path);
+			if (pathIt != byPath.end() && pathIt->second == id)
+			{
+				byPath.erase(pathIt);
+			}
+			byId.erase(it);
+		}
+		const char* pathOf(const unsigned int id) const
+		{
+			auto it = byId.find(id);
+			return it == byId.end() ? nullptr : it->second.path.c_str();
+		}
+		bool find(const std::string& path, Texture2D& texture, size_t*& ref) const
+		{
+			auto it = byPath.find(path);
+			if (it == byPath.end())
+			{
+				return false;
+			}
+			const Entry& entry = byId.at(it->second);
+			texture = entry.texture;
+			ref = entry.ref;
+			return true;
+		}
+	};
+
 	class TextureRAII
 	{
 	private:
 		Texture2D texture;
 		size_t* ref;
 
+		TextureRAII(const Texture2D& texture, size_t* ref) noexcept : texture(texture), ref(ref)
+		{
+			++(*ref);
+		}
+
 	public:
 		TextureRAII() noexcept : texture({}), ref(nullptr) {}
 
@@ -161,9 +226,30 @@ namespace rlRAII
 					UnloadTexture(texture);
 					texture = {};
 				}
+				else
+				{
+					TextureRegistry::instance().add(texturePath, texture, ref);
+				}
 			}
 		}
 
+		//·Դʱüļ
+		static TextureRAII Acquire(const std::string& texturePath)
+		{
+			Texture2D texture;
+			size_t* ref;
+			if (TextureRegistry::instance().find(texturePath, texture, ref))
+			{
+				return TextureRAII(texture, ref);
+			}
+			return TextureRAII(texturePath.c_str());
+		}
+		//ļʱ·Ϊnullptr
+		const char* path() const
+		{
+			return ref == nullptr ? nullptr : TextureRegistry::instance().pathOf(texture.id);
+		}
+
 		TextureRAII(const Texture texture)
 		{
 			if (texture.id == 0)
@@ -205,6 +291,7 @@ namespace rlRAII
 				--(*ref);
 				if (*ref == 0)
 				{
+					TextureRegistry::instance().remove(texture.id);
 					UnloadTexture(texture);
 					texture = {};
 					delete ref;
@@ -224,6 +311,7 @@ namespace rlRAII
 				--(*ref);
 				if (*ref == 0)
 				{
+					TextureRegistry::instance().remove(texture.id);
 					UnloadTexture(texture);
 					delete ref;
 				}
@@ -248,6 +336,7 @@ namespace rlRAII
 				--(*ref);
 				if (*ref == 0)
 				{
+					TextureRegistry::instance().remove(texture.id);
 					UnloadTexture(texture);
 					delete ref;
 				}